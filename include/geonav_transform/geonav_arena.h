@@ -0,0 +1,85 @@
+/*
+
+Copyright (c) 2017, Brian Bingham
+All rights reserved
+
+This file is part of the geonav_transform package.
+
+Geonav_transform is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Geonav_transform is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this package.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef GEONAV_TRANSFORM_GEONAV_ARENA_H
+#define GEONAV_TRANSFORM_GEONAV_ARENA_H
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+namespace GeonavTransform
+{
+
+//! @brief Monotonic (bump) allocator for per-batch outputs
+//!
+//! allocate() hands out memory from a list of blocks and never frees
+//! individual allocations.  reset() rewinds to the first block but keeps
+//! every block, so a loop that calls reset() before each batch stops
+//! allocating once the largest batch has been seen.
+//!
+//! Only trivially destructible types should be placed in the arena.
+//!
+class MonotonicArena
+{
+  public:
+    //! @brief Constructor
+    //! @param[in] block_size - size of the first block [bytes]
+    //!
+    explicit MonotonicArena(size_t block_size = 64*1024);
+
+    //! @brief Allocate an uninitialized array of count T's
+    //!
+    template <typename T>
+    T *allocate(size_t count)
+    {
+      return static_cast<T *>(allocateBytes(count * sizeof(T), alignof(T)));
+    }
+
+    //! @brief Release all allocations, keeping the memory for reuse
+    //!
+    void reset();
+
+    //! @brief Total size of the blocks owned by the arena [bytes]
+    //!
+    size_t capacity() const;
+
+  private:
+    struct Block
+    {
+      std::unique_ptr<unsigned char[]> data;
+      size_t size;
+    };
+
+    void *allocateBytes(size_t bytes, size_t alignment);
+
+    std::vector<Block> blocks_;
+
+    //! @brief Block currently allocated from, and the offset into it
+    //!
+    size_t current_;
+    size_t offset_;
+};
+
+}  // namespace GeonavTransform
+
+#endif  // GEONAV_TRANSFORM_GEONAV_ARENA_H
@@ -0,0 +1,270 @@
+/*
+
+Copyright (c) 2017, Brian Bingham
+All rights reserved
+
+This file is part of the geonav_transform package.
+
+Geonav_transform is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Geonav_transform is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this package.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef GEONAV_TRANSFORM_GEONAV_BATCH_H
+#define GEONAV_TRANSFORM_GEONAV_BATCH_H
+
+#include "geonav_transform/geonav_arena.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+namespace GeonavTransform
+{
+namespace GeonavBatch
+{
+  //! @brief Non-owning view of a caller supplied array
+  //!
+  template <typename T>
+  struct Span
+  {
+    Span() : data(NULL), size(0) {}
+    Span(T *d, size_t n) : data(d), size(n) {}
+    template <typename U>
+    Span(std::vector<U> &v) : data(v.empty() ? NULL : &v[0]), size(v.size()) {}
+    template <typename U>
+    Span(const std::vector<U> &v) : data(v.empty() ? NULL : &v[0]), size(v.size()) {}
+    template <typename U, size_t N>
+    Span(U (&a)[N]) : data(a), size(N) {}
+
+    T &operator[](size_t i) const { return data[i]; }
+    T *begin() const { return data; }
+    T *end() const { return data + size; }
+
+    T *data;
+    size_t size;
+  };
+
+  //! @brief Origin of a local (odom) frame expressed in UTM
+  //!
+  //! The odom frame is the datum's UTM zone shifted to the datum, with no
+  //! rotation, the same convention used by GeonavTransform::setDatum.
+  //!
+  struct Datum
+  {
+    //! @brief UTM zone number [1, 60]
+    int zone;
+    //! @brief UTM latitude band letter of the datum
+    char band;
+    //! @brief Hemisphere, which selects the false northing
+    bool north;
+    //! @brief UTM coordinates of the datum [m]
+    double northing;
+    double easting;
+    double altitude;
+  };
+
+  //! @brief Build a datum from a geographic position
+  //! @param[in] lat - latitude [dec. degrees]
+  //! @param[in] lon - longitude [dec. degrees]
+  //! @param[in] alt - altitude [m]
+  //! @return the datum, projected in its own UTM zone
+  //!
+  Datum makeDatum(double lat, double lon, double alt);
+
+  //! @brief UTM zone string (e.g., "10S") of a datum, as used by
+  //! NavsatConversions::UTMtoLL
+  //!
+  std::string zoneString(const Datum &datum);
+
+  //! @brief Compute the UTM zone number and band letter of each point
+  //! @param[in] lat, lon - input arrays [dec. degrees]
+  //! @param[in] count - number of points
+  //! @param[out] zone - zone numbers, may be NULL
+  //! @param[out] band - band letters ('Z' outside UTM limits), may be NULL
+  //!
+  void UTMZones(const double *lat, const double *lon, size_t count,
+                int *zone, char *band);
+
+  //! @brief Project points into a fixed UTM zone
+  //!
+  //! Unlike NavsatConversions::LLtoUTM, every point is projected into the
+  //! same zone and hemisphere, so results are continuous across zone lines.
+  //! Outputs may overwrite the inputs in place.
+  //!
+  //! @param[in] lat, lon - input arrays [dec. degrees]
+  //! @param[in] count - number of points
+  //! @param[in] zone - UTM zone number to project into
+  //! @param[in] north - hemisphere, selects the false northing
+  //! @param[out] northing, easting - output arrays [m]
+  //!
+  void LLtoUTM(const double *lat, const double *lon, size_t count,
+               int zone, bool north, double *northing, double *easting);
+
+  //! @brief Inverse of LLtoUTM for a fixed UTM zone
+  //!
+  void UTMtoLL(const double *northing, const double *easting, size_t count,
+               int zone, bool north, double *lat, double *lon);
+
+  //! @brief Convert geographic points to the local frame of a datum
+  //! @param[in] datum - origin of the local frame
+  //! @param[in] lat, lon - input arrays [dec. degrees]
+  //! @param[in] count - number of points
+  //! @param[out] x, y - local ENU coordinates [m]
+  //!
+  void LLtoLocal(const Datum &datum, const double *lat, const double *lon,
+                 size_t count, double *x, double *y);
+
+  //! @brief Convert local frame points of a datum to geographic
+  //!
+  void LocalToLL(const Datum &datum, const double *x, const double *y,
+                 size_t count, double *lat, double *lon);
+
+  //! @brief Exact reprojection of UTM coordinates into another zone
+  //!
+  //! Outputs may overwrite the inputs in place.
+  //!
+  //! @param[in] northing, easting - input arrays in from_zone [m]
+  //! @param[in] count - number of points
+  //! @param[in] from_zone, to_zone - UTM zone numbers
+  //! @param[in] north - hemisphere of both
+  //! @param[out] to_northing, to_easting - output arrays in to_zone [m]
+  //!
+  void UTMtoUTMZone(const double *northing, const double *easting,
+                    size_t count, int from_zone, int to_zone, bool north,
+                    double *to_northing, double *to_easting);
+
+  //! @brief Rigid (rotation + translation) approximation of the change
+  //! between two UTM zones, fitted at one point
+  //!
+  //! to = R(yaw) * from + (x, y).  Exact at the fit point; elsewhere the
+  //! differing grid scale of the two zones adds an error that grows with
+  //! the distance, about 0.1-0.3 m per km next to a zone line.  This is
+  //! what a static TF between zone frames can express; use UTMtoUTMZone
+  //! for exact results.
+  //!
+  struct ZoneTransform
+  {
+    int from_zone;
+    int to_zone;
+    bool north;
+    //! @brief Rotation about z [rad]
+    double yaw;
+    //! @brief Translation [m]
+    double x;
+    double y;
+  };
+
+  //! @brief Fit the transform from a zone into the datum's zone, at the datum
+  //!
+  ZoneTransform zoneTransform(const Datum &datum, int from_zone);
+
+  //! @brief Apply a ZoneTransform, in place if the outputs are the inputs
+  //!
+  void applyZoneTransform(const ZoneTransform &transform,
+                          const double *northing, const double *easting,
+                          size_t count,
+                          double *to_northing, double *to_easting);
+
+  //! @brief Zone numbers west and east of a zone, wrapping at 1/60
+  //!
+  inline int westZone(int zone) { return (zone == 1) ? 60 : zone - 1; }
+  inline int eastZone(int zone) { return (zone == 60) ? 1 : zone + 1; }
+
+  //! @brief Span forms of the kernels above
+  //!
+  //! Nothing is allocated; the outputs are owned by the caller.  The
+  //! number of points converted, the smallest of the span sizes, is
+  //! returned.
+  //!
+  inline size_t LLtoUTM(Span<const double> lat, Span<const double> lon,
+                        int zone, bool north,
+                        Span<double> northing, Span<double> easting)
+  {
+    size_t n = std::min(std::min(lat.size, lon.size),
+                        std::min(northing.size, easting.size));
+    LLtoUTM(lat.data, lon.data, n, zone, north, northing.data, easting.data);
+    return n;
+  }
+
+  inline size_t UTMtoLL(Span<const double> northing, Span<const double> easting,
+                        int zone, bool north,
+                        Span<double> lat, Span<double> lon)
+  {
+    size_t n = std::min(std::min(northing.size, easting.size),
+                        std::min(lat.size, lon.size));
+    UTMtoLL(northing.data, easting.data, n, zone, north, lat.data, lon.data);
+    return n;
+  }
+
+  inline size_t LLtoLocal(const Datum &datum,
+                          Span<const double> lat, Span<const double> lon,
+                          Span<double> x, Span<double> y)
+  {
+    size_t n = std::min(std::min(lat.size, lon.size), std::min(x.size, y.size));
+    LLtoLocal(datum, lat.data, lon.data, n, x.data, y.data);
+    return n;
+  }
+
+  inline size_t LocalToLL(const Datum &datum,
+                          Span<const double> x, Span<const double> y,
+                          Span<double> lat, Span<double> lon)
+  {
+    size_t n = std::min(std::min(x.size, y.size), std::min(lat.size, lon.size));
+    LocalToLL(datum, x.data, y.data, n, lat.data, lon.data);
+    return n;
+  }
+
+  //! @brief Per-point diagnostic flags
+  //!
+  enum PointFlags
+  {
+    POINT_OK = 0,
+    //! Latitude or longitude is NaN or infinite
+    POINT_INVALID = 1,
+    //! Latitude outside the UTM limits of 84N to 80S
+    POINT_OUTSIDE_UTM = 2,
+    //! Point belongs to a different UTM zone than the one projected into
+    POINT_OTHER_ZONE = 4
+  };
+
+  //! @brief Per-point zone IDs and diagnostics of a batch
+  //!
+  //! The arrays are allocated from the MonotonicArena passed to
+  //! checkPoints() and stay valid until that arena is reset.
+  //!
+  struct PointDiagnostics
+  {
+    size_t count;
+    //! @brief Number of points with any flag set
+    size_t flagged;
+    int *zone;
+    char *band;
+    //! @brief PointFlags bits of each point
+    uint8_t *flags;
+  };
+
+  //! @brief Compute zone IDs and diagnostics for a batch
+  //! @param[in] lat, lon - input spans [dec. degrees]
+  //! @param[in] zone - UTM zone the batch is projected into
+  //! @param[in] arena - storage for the outputs
+  //!
+  PointDiagnostics checkPoints(Span<const double> lat, Span<const double> lon,
+                               int zone, MonotonicArena &arena);
+
+}  // namespace GeonavBatch
+}  // namespace GeonavTransform
+
+#endif  // GEONAV_TRANSFORM_GEONAV_BATCH_H
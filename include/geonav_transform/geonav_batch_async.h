@@ -0,0 +1,146 @@
+/*
+
+Copyright (c) 2017, Brian Bingham
+All rights reserved
+
+This file is part of the geonav_transform package.
+
+Geonav_transform is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Geonav_transform is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this package.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef GEONAV_TRANSFORM_GEONAV_BATCH_ASYNC_H
+#define GEONAV_TRANSFORM_GEONAV_BATCH_ASYNC_H
+
+#include "geonav_transform/geonav_batch.h"
+#include "geonav_transform/geonav_thread_pool.h"
+
+#include <atomic>
+#include <functional>
+#include <future>
+#include <memory>
+
+namespace GeonavTransform
+{
+namespace GeonavBatch
+{
+  //! @brief Default number of points per task
+  //!
+  //! Four arrays of 1024 doubles fit in a 32 kB L1 data cache.
+  //!
+  const size_t DEFAULT_CHUNK_SIZE = 1024;
+
+  //! @brief Shared flag used to cancel queued conversions
+  //!
+  //! Copies refer to the same flag.  Chunks that have not started when
+  //! cancel() is called are skipped and their outputs are left untouched.
+  //!
+  class CancelToken
+  {
+    public:
+      CancelToken() : flag_(std::make_shared<std::atomic<bool> >(false)) {}
+
+      void cancel() { flag_->store(true); }
+
+      bool cancelled() const { return flag_->load(); }
+
+    private:
+      std::shared_ptr<std::atomic<bool> > flag_;
+  };
+
+  //! @brief How an asynchronous batch is split and where it runs
+  //!
+  struct BatchOptions
+  {
+    BatchOptions() : chunk_size(DEFAULT_CHUNK_SIZE), pool(NULL) {}
+
+    //! @brief Number of points per task
+    size_t chunk_size;
+    //! @brief Pool to run on, NULL for ThreadPool::shared()
+    ThreadPool *pool;
+    //! @brief Cancellation flag checked before each chunk
+    CancelToken cancel;
+  };
+
+  //! @brief Completion callback, given the number of points converted
+  //!
+  //! Called once, on a pool thread, after the last chunk finishes.
+  //!
+  typedef std::function<void(size_t)> BatchCallback;
+
+  //! @brief Split [0, count) into chunks and run kernel(begin, end) on the pool
+  //!
+  //! The building block for the asynchronous conversions below; done is
+  //! called with the number of points that were not cancelled.
+  //!
+  void runChunked(size_t count,
+                  const std::function<void(size_t, size_t)> &kernel,
+                  const BatchCallback &done,
+                  const BatchOptions &options = BatchOptions());
+
+  //! @brief Asynchronous GeonavBatch::LLtoUTM
+  //!
+  //! The arrays must stay valid until the batch completes.
+  //! @return future holding the number of points converted
+  //!
+  std::future<size_t> LLtoUTMAsync(const double *lat, const double *lon,
+                                   size_t count, int zone, bool north,
+                                   double *northing, double *easting,
+                                   const BatchOptions &options = BatchOptions());
+  void LLtoUTMAsync(const double *lat, const double *lon,
+                    size_t count, int zone, bool north,
+                    double *northing, double *easting,
+                    const BatchCallback &done,
+                    const BatchOptions &options = BatchOptions());
+
+  //! @brief Asynchronous GeonavBatch::UTMtoLL
+  //!
+  std::future<size_t> UTMtoLLAsync(const double *northing, const double *easting,
+                                   size_t count, int zone, bool north,
+                                   double *lat, double *lon,
+                                   const BatchOptions &options = BatchOptions());
+  void UTMtoLLAsync(const double *northing, const double *easting,
+                    size_t count, int zone, bool north,
+                    double *lat, double *lon,
+                    const BatchCallback &done,
+                    const BatchOptions &options = BatchOptions());
+
+  //! @brief Asynchronous GeonavBatch::LLtoLocal
+  //!
+  std::future<size_t> LLtoLocalAsync(const Datum &datum,
+                                     const double *lat, const double *lon,
+                                     size_t count, double *x, double *y,
+                                     const BatchOptions &options = BatchOptions());
+  void LLtoLocalAsync(const Datum &datum,
+                      const double *lat, const double *lon,
+                      size_t count, double *x, double *y,
+                      const BatchCallback &done,
+                      const BatchOptions &options = BatchOptions());
+
+  //! @brief Asynchronous GeonavBatch::LocalToLL
+  //!
+  std::future<size_t> LocalToLLAsync(const Datum &datum,
+                                     const double *x, const double *y,
+                                     size_t count, double *lat, double *lon,
+                                     const BatchOptions &options = BatchOptions());
+  void LocalToLLAsync(const Datum &datum,
+                      const double *x, const double *y,
+                      size_t count, double *lat, double *lon,
+                      const BatchCallback &done,
+                      const BatchOptions &options = BatchOptions());
+
+}  // namespace GeonavBatch
+}  // namespace GeonavTransform
+
+#endif  // GEONAV_TRANSFORM_GEONAV_BATCH_ASYNC_H
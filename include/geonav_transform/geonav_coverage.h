@@ -0,0 +1,203 @@
+/*
+
+Copyright (c) 2017, Brian Bingham
+All rights reserved
+
+This file is part of the geonav_transform package.
+
+Geonav_transform is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Geonav_transform is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this package.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef GEONAV_TRANSFORM_GEONAV_COVERAGE_H
+#define GEONAV_TRANSFORM_GEONAV_COVERAGE_H
+
+#include <cstddef>
+#include <stdint.h>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+namespace GeonavTransform
+{
+
+//! @brief Streaming survey coverage grid in a local frame
+//!
+//! Cells are allocated in square tiles only where the vehicle has been,
+//! up to a fixed number of tiles; beyond that the least recently updated
+//! tile is dropped, after encoding it if it has unpublished changes.  A
+//! dropped tile that is covered again restarts from zero in a new
+//! generation, which consumers add to the counts of the earlier ones.
+//! Each cell counts the swath passes covering it
+//! (visited cells are non-zero, overlap is > 1) and the soundings in it.
+//! Every pose only rasterizes the area swept since the previous one, and
+//! encode() run-length encodes the tiles changed since the last call.
+//!
+class CoverageGrid
+{
+  public:
+    //! @brief Cells along a tile side
+    //!
+    static const int TILE_SIZE = 64;
+    static const int TILE_CELLS = TILE_SIZE * TILE_SIZE;
+
+    //! @brief Run-length encoded tiles
+    //!
+    //! Tile t covers cells [tile_x[t], tile_y[t]] * TILE_SIZE onwards and
+    //! its runs, row by row from the lower left, are
+    //! [run_start[t], run_start[t+1]) (or to the end for the last tile).
+    //! generation[t] counts how often the tile was dropped before its
+    //! counts restarted from zero; the coverage of the tile is the sum of
+    //! the last counts of each generation.
+    //!
+    struct Encoded
+    {
+      std::vector<int32_t> tile_x;
+      std::vector<int32_t> tile_y;
+      std::vector<uint32_t> generation;
+      std::vector<uint32_t> run_start;
+      std::vector<uint16_t> run_length;
+      std::vector<uint16_t> run_passes;
+      std::vector<uint16_t> run_soundings;
+    };
+
+    //! @brief Constructor
+    //! @param[in] resolution - cell size [m]
+    //! @param[in] max_tiles - bound on the tiles kept in memory
+    //!
+    explicit CoverageGrid(double resolution = 1.0, size_t max_tiles = 1024);
+
+    //! @brief Drop all tiles and the track
+    //!
+    void clear();
+
+    //! @brief Longest step between poses that is rasterized [m]
+    //!
+    //! Longer steps (e.g., a position jump) start a new track instead.
+    //! 0 for no limit.
+    //!
+    void setMaxStep(double max_step);
+
+    //! @brief Add a vehicle pose in the local frame
+    //! @param[in] x, y - position [m]
+    //! @param[in] yaw - heading, ENU [rad]
+    //! @param[in] swath_width - across-track width centred on the
+    //! vehicle [m]; 0 only marks the cells along the track
+    //!
+    void addPose(double x, double y, double yaw, double swath_width = 0.0);
+
+    //! @brief Start a new track, e.g., after a gap in the poses
+    //!
+    void breakTrack();
+
+    //! @brief Count soundings in their cells; NaN positions are skipped
+    //!
+    void addSoundings(const double *x, const double *y, size_t count);
+
+    //! @brief Passes and soundings of the cell containing (x, y), in the
+    //! tile's current generation
+    //! @return false if the cell isn't in memory (never covered or dropped)
+    //!
+    bool cell(double x, double y, uint16_t &passes, uint16_t &soundings) const;
+
+    //! @brief Encode tiles into out, replacing its contents
+    //!
+    //! Tiles dropped with unpublished changes since the last call come
+    //! first, with their final counts, so a tile may appear twice; later
+    //! entries replace earlier ones.
+    //!
+    //! @param[in] changed_only - only the tiles changed since the last call
+    //! @return number of tiles encoded
+    //!
+    size_t encode(bool changed_only, Encoded &out);
+
+    //! @brief Decode tile t of an Encoded into TILE_CELLS arrays
+    //! @return false if the runs don't add up to a tile
+    //!
+    static bool decode(const Encoded &in, size_t t,
+                       uint16_t *passes, uint16_t *soundings);
+
+    double resolution() const;
+
+    //! @brief Tiles in memory
+    //!
+    size_t tiles() const;
+
+    //! @brief Tiles dropped to stay within max_tiles
+    //!
+    size_t evicted() const;
+
+  private:
+    struct Tile
+    {
+      int32_t x;
+      int32_t y;
+      //! @brief Neighbouring slots in the least recently updated order
+      size_t older;
+      size_t newer;
+      uint32_t generation;
+      bool dirty;
+      uint16_t passes[TILE_CELLS];
+      uint16_t soundings[TILE_CELLS];
+    };
+
+    //! @brief Tile containing cell (i, j), allocated (or recycled) if
+    //! needed, and made the most recently updated
+    Tile &tileFor(int i, int j);
+
+    //! @brief Move a slot to the most recently updated end
+    void touch(size_t slot);
+
+    //! @brief Append the runs of a tile to out
+    static void encodeTile(const Tile &tile, Encoded &out);
+
+    //! @brief Add a pass to cells [i0, i1) of row j
+    void markSpan(int i0, int i1, int j);
+
+    //! @brief Add a pass to the cells crossed by a track segment, except
+    //! the cell of its start (marked by the previous segment)
+    void markTrack(double x0, double y0, double x1, double y1);
+
+    //! @brief Add a pass to the cells whose centre is in a quadrilateral
+    void fillQuad(const double *qx, const double *qy);
+
+    double resolution_;
+    size_t max_tiles_;
+    double max_step_;
+    std::vector<std::unique_ptr<Tile> > tiles_;
+    std::unordered_map<int64_t, size_t> index_;
+    //! @brief Slot of the last tile used, most updates stay in one tile
+    size_t last_slot_;
+    //! @brief Least and most recently updated slots, linked by Tile::newer
+    size_t oldest_;
+    size_t newest_;
+    size_t evicted_;
+    //! @brief Dropped tiles not encoded since their last change
+    Encoded pending_;
+    //! @brief Next generation of each dropped tile not in memory; a key
+    //! and a counter per tile, against the TILE_CELLS counts it drops
+    std::unordered_map<int64_t, uint32_t> generations_;
+
+    //! @brief End of the track so far
+    bool has_last_;
+    double last_x_;
+    double last_y_;
+    double last_width_;
+    double last_left_[2];
+    double last_right_[2];
+};
+
+}  // namespace GeonavTransform
+
+#endif  // GEONAV_TRANSFORM_GEONAV_COVERAGE_H
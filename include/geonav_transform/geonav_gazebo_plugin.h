@@ -0,0 +1,101 @@
+/*
+
+Copyright (c) 2017, Brian Bingham
+All rights reserved
+
+This file is part of the geonav_transform package.
+
+Geonav_transform is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Geonav_transform is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this package.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef GEONAV_TRANSFORM_GEONAV_GAZEBO_PLUGIN_H
+#define GEONAV_TRANSFORM_GEONAV_GAZEBO_PLUGIN_H
+
+#include <gazebo/common/common.hh>
+#include <gazebo/physics/physics.hh>
+
+#include <ros/ros.h>
+#include <nav_msgs/Odometry.h>
+
+#include "geonav_transform/geonav_batch.h"
+#include "geonav_transform/geonav_utilities.h"
+
+#include <memory>
+#include <string>
+
+namespace GeonavTransform
+{
+
+//! @brief Gazebo model plugin publishing geonav outputs in-process
+//!
+//! Converts the simulated world pose of the model (or of one of its
+//! links) with the conversion library at physics rates, and publishes the
+//! same geonav_odom, geonav_utm and geonav_geo Odometry as the node, under
+//! the model's namespace.  This replaces the Gazebo -> odometry publisher
+//! -> geonav_transform_node chain and its two serializations per step.
+//!
+//! The Gazebo world frame is a translation of the odom frame (ENU, no
+//! rotation), with its origin at <gazebo_origin> (default: the datum).
+//!
+//!   <plugin name="geonav" filename="libgeonav_gazebo_plugin.so">
+//!     <datum>36.595 -121.89 0.0</datum>
+//!     <gazebo_origin>36.596524 -121.888169 0.0</gazebo_origin>
+//!     <update_rate>50</update_rate>   <!-- Hz, 0 for every step -->
+//!   </plugin>
+//!
+class GeonavGazeboPlugin : public gazebo::ModelPlugin
+{
+  public:
+    GeonavGazeboPlugin();
+
+    ~GeonavGazeboPlugin();
+
+    //! @brief Reads the SDF parameters and connects to the world update
+    //!
+    void Load(gazebo::physics::ModelPtr model, sdf::ElementPtr sdf);
+
+  private:
+    //! @brief Converts and publishes the pose, at most at update_rate_
+    //!
+    void onUpdate(const gazebo::common::UpdateInfo &info);
+
+    gazebo::physics::ModelPtr model_;
+    //! @brief Link whose pose is published, the model's if NULL
+    gazebo::physics::LinkPtr link_;
+    gazebo::event::ConnectionPtr update_connection_;
+
+    GeonavBatch::Datum datum_;
+    //! @brief Gazebo world origin in the odom frame [m]
+    double origin_x_;
+    double origin_y_;
+    double origin_z_;
+
+    double update_rate_;
+    GeonavUtilities::RateLimiter limiter_;
+
+    std::unique_ptr<ros::NodeHandle> nh_;
+    ros::Publisher odom_pub_;
+    ros::Publisher utm_pub_;
+    ros::Publisher geo_pub_;
+
+    //! @brief Outputs, reused between updates
+    nav_msgs::Odometry nav_in_odom_;
+    nav_msgs::Odometry nav_in_utm_;
+    nav_msgs::Odometry nav_in_geo_;
+};
+
+}  // namespace GeonavTransform
+
+#endif  // GEONAV_TRANSFORM_GEONAV_GAZEBO_PLUGIN_H
@@ -0,0 +1,196 @@
+/*
+
+Copyright (c) 2017, Brian Bingham
+All rights reserved
+
+This file is part of the geonav_transform package.
+
+Geonav_transform is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Geonav_transform is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this package.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef GEONAV_TRANSFORM_GEONAV_GEODESIC_H
+#define GEONAV_TRANSFORM_GEONAV_GEODESIC_H
+
+#include "geonav_transform/geonav_batch_async.h"
+
+#include <cstddef>
+#include <future>
+
+//! Geodesics on the WGS84 ellipsoid
+//!
+//! A port of the series solution in C. F. F. Karney, "Algorithms for
+//! geodesics", J. Geodesy 87, 43-55 (2013), after GeographicLib (MIT
+//! license).  Distances are accurate to about 15 nm anywhere on the globe,
+//! including nearly antipodal points.
+//!
+//! Azimuths are in degrees, clockwise from north, in [-180, 180]; the
+//! ENU yaw of the rest of the package is 90 - azimuth, in radians.
+//!
+namespace GeonavTransform
+{
+namespace GeonavGeodesic
+{
+  //! @brief Shortest path between two points (inverse problem)
+  //! @param[in] lat1, lon1 - first point [dec. degrees]
+  //! @param[in] lat2, lon2 - second point [dec. degrees]
+  //! @param[out] s12 - distance between the points [m]
+  //! @param[out] azi1 - azimuth at the first point [dec. degrees]
+  //! @param[out] azi2 - (forward) azimuth at the second point [dec. degrees]
+  //!
+  void inverse(double lat1, double lon1, double lat2, double lon2,
+               double &s12, double &azi1, double &azi2);
+
+  //! @brief Distance between two points [m]
+  //!
+  double distance(double lat1, double lon1, double lat2, double lon2);
+
+  //! @brief Point at a distance and azimuth (direct problem)
+  //! @param[in] lat1, lon1 - start point [dec. degrees]
+  //! @param[in] azi1 - azimuth at the start point [dec. degrees]
+  //! @param[in] s12 - distance to travel, may be negative [m]
+  //! @param[out] lat2, lon2 - end point, lon2 in [-180, 180] [dec. degrees]
+  //! @param[out] azi2 - (forward) azimuth at the end point [dec. degrees]
+  //!
+  void direct(double lat1, double lon1, double azi1, double s12,
+              double &lat2, double &lon2, double &azi2);
+
+  //! @brief Geodesic from a point and azimuth, for repeated direct problems
+  //!
+  //! Holds the per-geodesic series coefficients, so each position() costs a
+  //! few trig calls.
+  //!
+  class GeodesicLine
+  {
+    public:
+      //! @param[in] lat1, lon1 - start point [dec. degrees]
+      //! @param[in] azi1 - azimuth at the start point [dec. degrees]
+      //!
+      GeodesicLine(double lat1, double lon1, double azi1);
+
+      //! @brief Point a distance s12 [m] along the line
+      //!
+      void position(double s12, double &lat2, double &lon2, double &azi2) const;
+
+    private:
+      //! @brief Order of the series expansions
+      static const int ORDER = 6;
+
+      double lon1_;
+      double salp0_;
+      double calp0_;
+      double ssig1_;
+      double csig1_;
+      double somg1_;
+      double comg1_;
+      double A1m1_;
+      double B11_;
+      double stau1_;
+      double ctau1_;
+      double A3c_;
+      double B31_;
+      //! @brief Series coefficients, index 0 is unused
+      double C1pa_[ORDER + 1];
+      double C3a_[ORDER];
+  };
+
+  //! @brief Batch inverse, point i of the first arrays to point i of the
+  //! second
+  //!
+  //! Any of the outputs may be NULL.
+  //!
+  void inverse(const double *lat1, const double *lon1,
+               const double *lat2, const double *lon2, size_t count,
+               double *s12, double *azi1, double *azi2);
+
+  //! @brief Batch direct, one start point, azimuth and distance per element
+  //!
+  //! Any of the outputs may be NULL.
+  //!
+  void direct(const double *lat1, const double *lon1,
+              const double *azi1, const double *s12, size_t count,
+              double *lat2, double *lon2, double *azi2);
+
+  //! @brief Distances and azimuths from every row point to every column point
+  //!
+  //! Outputs are rows x cols, row-major: s12[r*cols + c] is the distance
+  //! from (lat1[r], lon1[r]) to (lat2[c], lon2[c]).  The per-point terms are
+  //! computed once per row or column instead of once per pair, and columns
+  //! are processed in cache-sized blocks.  Passing the same arrays for the
+  //! rows and the columns (a fleet to itself) solves only half the pairs.
+  //! azi1 and azi2 may be NULL.
+  //!
+  void distanceMatrix(const double *lat1, const double *lon1, size_t rows,
+                      const double *lat2, const double *lon2, size_t cols,
+                      double *s12, double *azi1 = NULL, double *azi2 = NULL);
+
+  //! @brief One-to-many distances, distanceMatrix() with a single row
+  //!
+  inline void distancesFrom(double lat1, double lon1,
+                            const double *lat2, const double *lon2,
+                            size_t count, double *s12,
+                            double *azi1 = NULL, double *azi2 = NULL)
+  {
+    distanceMatrix(&lat1, &lon1, 1, lat2, lon2, count, s12, azi1, azi2);
+  }
+
+  //! @brief Asynchronous distanceMatrix(), split by rows across the pool
+  //!
+  //! options.chunk_size is the number of matrix elements per task, rounded
+  //! to whole rows.  The arrays must stay valid until the batch completes.
+  //! @return future holding the number of rows computed
+  //!
+  std::future<size_t> distanceMatrixAsync(
+    const double *lat1, const double *lon1, size_t rows,
+    const double *lat2, const double *lon2, size_t cols,
+    double *s12, double *azi1, double *azi2,
+    const GeonavBatch::BatchOptions &options = GeonavBatch::BatchOptions());
+  void distanceMatrixAsync(
+    const double *lat1, const double *lon1, size_t rows,
+    const double *lat2, const double *lon2, size_t cols,
+    double *s12, double *azi1, double *azi2,
+    const GeonavBatch::BatchCallback &done,
+    const GeonavBatch::BatchOptions &options = GeonavBatch::BatchOptions());
+
+  //! @brief Densify a polyline along geodesics, projected into the local
+  //! frame of a datum
+  //!
+  //! Each leg is split into equal geodesic steps, no longer than spacing
+  //! and short enough that the straight chords in the local frame stay
+  //! within tolerance of the true geodesic.  Either rule is disabled by 0.
+  //! The vertices are kept.  Points are projected in blocks as they are
+  //! generated; nothing is allocated.
+  //!
+  //! @param[in] datum - origin of the local frame
+  //! @param[in] lat, lon - polyline vertices [dec. degrees]
+  //! @param[in] count - number of vertices
+  //! @param[in] spacing - largest step along the geodesic [m]
+  //! @param[in] tolerance - largest chord to geodesic deviation [m]
+  //! @param[out] x, y - local ENU coordinates of the densified path [m]
+  //! @param[out] param - per point, the index of the leg's first vertex
+  //! plus the fraction of the leg; may be NULL
+  //! @param[in] capacity - size of the output arrays
+  //! @return number of points in the densified path.  Only the first
+  //! capacity of them are written, so a call with capacity 0 sizes the
+  //! outputs.
+  //!
+  size_t densify(const GeonavBatch::Datum &datum,
+                 const double *lat, const double *lon, size_t count,
+                 double spacing, double tolerance,
+                 double *x, double *y, double *param, size_t capacity);
+
+}  // namespace GeonavGeodesic
+}  // namespace GeonavTransform
+
+#endif  // GEONAV_TRANSFORM_GEONAV_GEODESIC_H
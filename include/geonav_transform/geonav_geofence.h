@@ -0,0 +1,144 @@
+/*
+
+Copyright (c) 2017, Brian Bingham
+All rights reserved
+
+This file is part of the geonav_transform package.
+
+Geonav_transform is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Geonav_transform is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this package.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef GEONAV_TRANSFORM_GEONAV_GEOFENCE_H
+#define GEONAV_TRANSFORM_GEONAV_GEOFENCE_H
+
+#include "geonav_transform/geonav_batch.h"
+
+#include <cstddef>
+#include <stdint.h>
+#include <vector>
+
+namespace GeonavTransform
+{
+
+//! @brief Polygon geofence with a uniform grid index
+//!
+//! Polygons are given in (or projected once into) a local frame.  build()
+//! indexes their edges in a uniform grid and records, for every cell,
+//! whether its center is inside each polygon.  check() then only looks at
+//! the edges of the cell containing the point (and of the rings of cells
+//! around it for the distance), so its cost doesn't depend on the total
+//! number of vertices.
+//!
+//! The allowed area is inside any keep-in polygon (or anywhere if there
+//! are none) and outside every keep-out polygon.
+//!
+class Geofence
+{
+  public:
+    //! @brief Result of a check
+    //!
+    struct Result
+    {
+      //! @brief Whether the point is in the allowed area
+      bool inside;
+      //! @brief Distance to the nearest fence edge [m], negative when
+      //! outside the allowed area (breach distance)
+      double distance;
+      //! @brief Polygon of the nearest edge, -1 if there are no polygons
+      int polygon;
+    };
+
+    Geofence();
+
+    //! @brief Add a polygon in the local frame
+    //! @param[in] x, y - vertices [m]; the polygon is closed implicitly
+    //! @param[in] count - number of vertices, at least 3
+    //! @param[in] keep_out - true for an exclusion zone
+    //! @return index of the polygon
+    //!
+    size_t addPolygon(const double *x, const double *y, size_t count,
+                      bool keep_out = false);
+
+    //! @brief Add a geographic polygon, projected once into the local frame
+    //! of datum
+    //!
+    size_t addPolygon(const GeonavBatch::Datum &datum,
+                      const double *lat, const double *lon, size_t count,
+                      bool keep_out = false);
+
+    //! @brief Build the grid index; call after adding polygons
+    //! @param[in] cell_size - grid cell size [m], e.g., a few times the
+    //! typical edge length.  Grown if needed to keep the grid under about
+    //! four million cells and its inside flags, a bit per cell and
+    //! polygon, under 4 MB.
+    //!
+    void build(double cell_size);
+
+    //! @brief Test a point in the local frame
+    //!
+    //! Points outside the grid (far from every polygon) fall back to
+    //! testing all edges for the distance.  Uses internal scratch space,
+    //! so concurrent calls on the same Geofence are not safe.
+    //!
+    Result check(double x, double y) const;
+
+    //! @brief Number of polygons
+    //!
+    size_t size() const;
+
+  private:
+    struct Edge
+    {
+      double x0;
+      double y0;
+      double x1;
+      double y1;
+      int polygon;
+    };
+
+    //! @brief Visit the edges of one cell, updating the nearest one
+    void nearestInCell(int cx, int cy, double x, double y,
+                       double &best, int &polygon) const;
+
+    //! @brief Edges, polygon by polygon; polygon p has edges
+    //! [polygon_start_[p], polygon_start_[p+1])
+    std::vector<Edge> edges_;
+    std::vector<size_t> polygon_start_;
+    std::vector<uint8_t> keep_out_;
+    bool has_keep_in_;
+
+    //! @brief Grid origin, cell size and dimensions
+    double min_x_;
+    double min_y_;
+    double cell_size_;
+    int nx_;
+    int ny_;
+
+    //! @brief Edges of each cell, CSR style: cell c has
+    //! cell_edges_[cell_start_[c] .. cell_start_[c+1])
+    std::vector<uint32_t> cell_start_;
+    std::vector<uint32_t> cell_edges_;
+
+    //! @brief Whether the center of cell c is inside polygon p, one bit
+    //! each at bit p * cells + c
+    std::vector<uint64_t> center_inside_;
+
+    //! @brief Per-polygon containment of the point being checked
+    mutable std::vector<uint8_t> scratch_;
+};
+
+}  // namespace GeonavTransform
+
+#endif  // GEONAV_TRANSFORM_GEONAV_GEOFENCE_H
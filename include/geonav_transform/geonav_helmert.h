@@ -0,0 +1,156 @@
+/*
+
+Copyright (c) 2017, Brian Bingham
+All rights reserved
+
+This file is part of the geonav_transform package.
+
+Geonav_transform is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Geonav_transform is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this package.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef GEONAV_TRANSFORM_GEONAV_HELMERT_H
+#define GEONAV_TRANSFORM_GEONAV_HELMERT_H
+
+#include "geonav_transform/geonav_batch.h"
+
+#include <cstddef>
+#include <string>
+
+namespace GeonavTransform
+{
+//! @brief 7-parameter Helmert datum transformations to and from WGS84
+//!
+//! For bringing legacy survey positions (NAD27, ED50, ...) into WGS84
+//! before LLtoUTM.  Each point goes geodetic -> ECEF on the source
+//! ellipsoid -> Helmert -> geodetic on the target ellipsoid in one
+//! branch-free loop; the rotation and scale are folded into one matrix
+//! when the DatumShift is built.
+//!
+namespace GeonavHelmert
+{
+  //! @brief Datums in the compiled table
+  //!
+  enum DatumId
+  {
+    WGS84 = 0,
+    NAD83,
+    NAD27,
+    ED50,
+    OSGB36,
+    DHDN,
+    TOKYO,
+    PULKOVO42,
+    DATUM_COUNT
+  };
+
+  //! @brief Reference ellipsoid
+  //!
+  struct Ellipsoid
+  {
+    //! @brief Semi-major axis [m]
+    double a;
+    //! @brief Inverse flattening
+    double inverse_f;
+  };
+
+  //! @brief Datum and its transformation to WGS84
+  //!
+  //! Position vector convention (as EPSG:9606 and PROJ +towgs84):
+  //! X_wgs84 = T + (1 + ds) R X, with R the small angle rotation matrix.
+  //!
+  struct DatumParameters
+  {
+    const char *name;
+    Ellipsoid ellipsoid;
+    //! @brief Translation [m]
+    double tx;
+    double ty;
+    double tz;
+    //! @brief Rotations [arc seconds]
+    double rx;
+    double ry;
+    double rz;
+    //! @brief Scale [ppm]
+    double ds;
+  };
+
+  //! @brief Entry of the table
+  //!
+  const DatumParameters &datumParameters(DatumId id);
+
+  //! @brief Find a datum of the table by name (e.g., "NAD27"), case
+  //! insensitive
+  //! @return false if there is no such datum
+  //!
+  bool findDatum(const std::string &name, DatumId &id);
+
+  //! @brief Precomputed transformation between a datum and WGS84
+  //!
+  struct DatumShift
+  {
+    //! @brief Source ellipsoid: semi-major axis and e^2
+    double a;
+    double e2;
+    //! @brief Translation [m] and scaled rotation, row-major, to WGS84
+    double t[3];
+    double m[9];
+    //! @brief Inverse of m, from WGS84
+    double m_inverse[9];
+  };
+
+  //! @brief Build the transformation of a table datum or of custom
+  //! parameters
+  //!
+  DatumShift datumShift(DatumId id);
+  DatumShift datumShift(const DatumParameters &parameters);
+
+  //! @brief Transform geodetic points of the shift's datum to WGS84
+  //!
+  //! Outputs may overwrite the inputs in place.
+  //!
+  //! @param[in] lat, lon - input arrays [dec. degrees]
+  //! @param[in] alt - ellipsoidal heights [m], NULL for 0
+  //! @param[in] count - number of points
+  //! @param[out] lat_out, lon_out - output arrays [dec. degrees]
+  //! @param[out] alt_out - heights on WGS84 [m], may be NULL
+  //!
+  void toWGS84(const DatumShift &shift,
+               const double *lat, const double *lon, const double *alt,
+               size_t count,
+               double *lat_out, double *lon_out, double *alt_out);
+
+  //! @brief Inverse of toWGS84
+  //!
+  void fromWGS84(const DatumShift &shift,
+                 const double *lat, const double *lon, const double *alt,
+                 size_t count,
+                 double *lat_out, double *lon_out, double *alt_out);
+
+  //! @brief toWGS84 followed by GeonavBatch::LLtoUTM, in stack blocks
+  //!
+  void toUTM(const DatumShift &shift, const double *lat, const double *lon,
+             size_t count, int zone, bool north,
+             double *northing, double *easting);
+
+  //! @brief toWGS84 followed by GeonavBatch::LLtoLocal, in stack blocks
+  //!
+  void toLocal(const DatumShift &shift, const GeonavBatch::Datum &datum,
+               const double *lat, const double *lon, size_t count,
+               double *x, double *y);
+
+}  // namespace GeonavHelmert
+}  // namespace GeonavTransform
+
+#endif  // GEONAV_TRANSFORM_GEONAV_HELMERT_H
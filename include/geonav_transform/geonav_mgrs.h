@@ -0,0 +1,102 @@
+/*
+
+Copyright (c) 2017, Brian Bingham
+All rights reserved
+
+This file is part of the geonav_transform package.
+
+Geonav_transform is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Geonav_transform is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this package.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef GEONAV_TRANSFORM_GEONAV_MGRS_H
+#define GEONAV_TRANSFORM_GEONAV_MGRS_H
+
+#include <cstddef>
+
+namespace GeonavTransform
+{
+//! @brief Military Grid Reference System (MGRS) strings
+//!
+//! Built on the GeonavBatch UTM kernels and the 100 km grid
+//! (NavsatConversions::grid_size), WGS84 lettering.  Strings are written
+//! to and read from fixed-width records in caller buffers, e.g.
+//!
+//!   char buf[count][GeonavMgrs::MAX_SIZE];
+//!   GeonavMgrs::encode(lat, lon, count, 5, buf[0], GeonavMgrs::MAX_SIZE);
+//!
+//! so converting long lists allocates nothing.  Only the UTM area (80S to
+//! 84N) is covered; the polar UPS squares are not.
+//!
+namespace GeonavMgrs
+{
+  //! @brief Record size for the finest precision (1 m), including the
+  //! terminating NUL, e.g. "18SUJ2339307395"
+  //!
+  const size_t MAX_SIZE = 16;
+
+  //! @brief Record size needed for a precision, including the NUL
+  //! @param[in] precision - digits per coordinate, 0 (100 km) to 5 (1 m)
+  //!
+  inline size_t encodedSize(int precision) { return 6 + 2 * precision; }
+
+  //! @brief Encode geographic points as MGRS strings
+  //!
+  //! The zone is always two digits ("04QFJ..."), so every string of a
+  //! precision has the same length.  Coordinates are truncated to the
+  //! precision, as the standard requires.  Points that are NaN or outside
+  //! the UTM area are written as empty strings.
+  //!
+  //! @param[in] lat, lon - input arrays [dec. degrees]
+  //! @param[in] count - number of points
+  //! @param[in] precision - digits per coordinate, 0 to 5
+  //! @param[out] out - count records of stride chars, NUL terminated
+  //! @param[in] stride - record size, at least encodedSize(precision)
+  //! @return number of points encoded; 0 if precision or stride is invalid
+  //!
+  size_t encode(const double *lat, const double *lon, size_t count,
+                int precision, char *out, size_t stride = MAX_SIZE);
+
+  //! @brief Decode MGRS strings to UTM
+  //!
+  //! Records are read up to a NUL or stride chars.  Spaces are ignored,
+  //! letters may be lower case and the zone may have one digit.  Invalid
+  //! records give zone 0 and NaN coordinates.
+  //!
+  //! @param[in] in - count records of stride chars
+  //! @param[in] centre - true for the centre of the referenced square,
+  //! false for its south west corner
+  //! @param[out] zone - UTM zone numbers
+  //! @param[out] north - hemispheres, 1 for north
+  //! @param[out] northing, easting - UTM coordinates [m]
+  //! @return number of records decoded
+  //!
+  size_t decodeUTM(const char *in, size_t count, size_t stride, bool centre,
+                   int *zone, unsigned char *north,
+                   double *northing, double *easting);
+
+  //! @brief Decode MGRS strings to geographic
+  //!
+  //! As decodeUTM; runs of records in the same zone are converted
+  //! together.  Invalid records give NaN.
+  //!
+  //! @param[out] lat, lon - output arrays [dec. degrees]
+  //!
+  size_t decode(const char *in, size_t count, size_t stride, bool centre,
+                double *lat, double *lon);
+
+}  // namespace GeonavMgrs
+}  // namespace GeonavTransform
+
+#endif  // GEONAV_TRANSFORM_GEONAV_MGRS_H
@@ -0,0 +1,133 @@
+/*
+
+Copyright (c) 2017, Brian Bingham
+All rights reserved
+
+This file is part of the geonav_transform package.
+
+Geonav_transform is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Geonav_transform is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this package.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef GEONAV_TRANSFORM_GEONAV_MISSION_PATH_H
+#define GEONAV_TRANSFORM_GEONAV_MISSION_PATH_H
+
+#include "geonav_transform/geonav_batch.h"
+
+#include <cstddef>
+#include <vector>
+
+namespace GeonavTransform
+{
+
+//! @brief Cross-track and along-track errors against a mission path
+//!
+//! The waypoints are given in (or projected once into) a local frame and
+//! the legs between them precomputed, with their direction, length and
+//! distance from the start of the path.  track() starts from the leg of
+//! the previous call and only moves to neighbouring legs, so for a
+//! vehicle making progress along the path each call is O(1) amortized.
+//! The whole path is only searched for the first fix, after reset(), or
+//! when the vehicle is further than the reacquire distance off the leg.
+//!
+class MissionPath
+{
+  public:
+    //! @brief Where a point is relative to the path
+    //!
+    struct Result
+    {
+      //! @brief Current leg, counting legs of non-zero length
+      size_t leg;
+      //! @brief Distance off the leg [m], positive to the left of it
+      double cross_track;
+      //! @brief Distance along the path from its start to the projection
+      //! of the point [m]
+      double along_track;
+      //! @brief Distance along the path from the projection to its end [m]
+      double remaining;
+      //! @brief Next waypoint (end of the leg), index into the waypoints
+      //! given to setPath
+      size_t next_waypoint;
+      //! @brief Straight line distance to the next waypoint [m]
+      double next_waypoint_distance;
+      //! @brief Direction of the leg, ENU yaw [rad]
+      double leg_heading;
+      //! @brief Whether the point is past the end of the last leg
+      bool complete;
+    };
+
+    //! @brief Constructor
+    //! @param[in] reacquire_distance - cross-track distance beyond which
+    //! the whole path is searched again [m]
+    //!
+    explicit MissionPath(double reacquire_distance = 200.0);
+
+    //! @brief Set the waypoints in the local frame
+    //!
+    //! Consecutive duplicate waypoints are dropped.  Resets the cursor.
+    //!
+    void setPath(const double *x, const double *y, size_t count);
+
+    //! @brief Set geographic waypoints, projected once into the local
+    //! frame of datum
+    //!
+    void setPath(const GeonavBatch::Datum &datum,
+                 const double *lat, const double *lon, size_t count);
+
+    //! @brief Locate a point relative to the path
+    //! @return false if the path has fewer than two waypoints
+    //!
+    bool track(double x, double y, Result &result);
+
+    //! @brief Forget the current leg, so the next track() searches the
+    //! whole path
+    //!
+    void reset();
+
+    //! @brief Number of legs
+    //!
+    size_t legs() const;
+
+  private:
+    struct Leg
+    {
+      //! @brief Start waypoint [m]
+      double x;
+      double y;
+      //! @brief Unit direction
+      double ux;
+      double uy;
+      double length;
+      //! @brief Distance along the path at the start of the leg [m]
+      double start;
+      //! @brief Index of the end waypoint
+      size_t waypoint;
+    };
+
+    //! @brief Distance along leg i of the projection of the point
+    double alongLeg(size_t i, double x, double y) const;
+
+    //! @brief Distance from the point to leg i (as a segment) squared
+    double distance2(size_t i, double x, double y) const;
+
+    std::vector<Leg> legs_;
+    double reacquire_distance_;
+    size_t cursor_;
+    bool have_cursor_;
+};
+
+}  // namespace GeonavTransform
+
+#endif  // GEONAV_TRANSFORM_GEONAV_MISSION_PATH_H
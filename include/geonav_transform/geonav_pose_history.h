@@ -0,0 +1,107 @@
+/*
+
+Copyright (c) 2017, Brian Bingham
+All rights reserved
+
+This file is part of the geonav_transform package.
+
+Geonav_transform is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Geonav_transform is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this package.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef GEONAV_TRANSFORM_GEONAV_POSE_HISTORY_H
+#define GEONAV_TRANSFORM_GEONAV_POSE_HISTORY_H
+
+#include <cstddef>
+#include <vector>
+
+namespace GeonavTransform
+{
+
+//! @brief Fixed capacity, time ordered ring buffer of poses
+//!
+//! For time aligning one pose stream with another, e.g., the vehicle with a
+//! moving support ship.  Storage is allocated once by the constructor; when
+//! full, push() overwrites the oldest sample.
+//!
+class PoseHistory
+{
+  public:
+    //! @brief Pose at a time, position in a fixed (e.g., utm) frame
+    //!
+    struct Sample
+    {
+      //! @brief Time [s]
+      double stamp;
+      //! @brief Position [m]
+      double x;
+      double y;
+      double z;
+      //! @brief Orientation, unit quaternion
+      double qx;
+      double qy;
+      double qz;
+      double qw;
+    };
+
+    //! @brief Constructor
+    //! @param[in] capacity - maximum number of samples kept
+    //!
+    explicit PoseHistory(size_t capacity = 256);
+
+    //! @brief Append a sample
+    //! @return false, and the sample is dropped, if it isn't newer than the
+    //! latest one
+    //!
+    bool push(const Sample &sample);
+
+    //! @brief Pose at a time
+    //!
+    //! Interpolates between the samples around stamp (linear for position,
+    //! slerp for orientation).  After the latest sample, the latest pose is
+    //! held for up to max_gap.
+    //!
+    //! @param[in] stamp - time [s]
+    //! @param[in] max_gap - largest gap between samples to interpolate
+    //! across, and to hold the latest sample for [s]
+    //! @param[out] pose - the pose at stamp
+    //! @return false if stamp isn't covered by the history
+    //!
+    bool interpolate(double stamp, double max_gap, Sample &pose) const;
+
+    //! @brief Number of samples kept
+    //!
+    size_t size() const;
+
+    //! @brief Latest sample, size() must not be 0
+    //!
+    const Sample &latest() const;
+
+    //! @brief Remove all samples, keeping the storage
+    //!
+    void clear();
+
+  private:
+    //! @brief i-th sample, oldest first
+    const Sample &at(size_t i) const;
+
+    std::vector<Sample> samples_;
+    //! @brief Index of the oldest sample
+    size_t head_;
+    size_t count_;
+};
+
+}  // namespace GeonavTransform
+
+#endif  // GEONAV_TRANSFORM_GEONAV_POSE_HISTORY_H
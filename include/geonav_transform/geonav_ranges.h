@@ -0,0 +1,406 @@
+/*
+
+Copyright (c) 2017, Brian Bingham
+All rights reserved
+
+This file is part of the geonav_transform package.
+
+Geonav_transform is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Geonav_transform is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this package.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef GEONAV_TRANSFORM_GEONAV_RANGES_H
+#define GEONAV_TRANSFORM_GEONAV_RANGES_H
+
+#include "geonav_transform/geonav_batch.h"
+
+#include <cstddef>
+#include <iterator>
+#include <utility>
+
+#if __cplusplus >= 202002L
+#include <ranges>
+#endif
+
+//! Lazy, pipeable conversion views
+//!
+//!   for (const LocalPoint &p : track | GeonavRanges::toLocal(datum)) ...
+//!
+//! The views convert on the fly and never allocate.  Elements are pulled
+//! from the underlying range BLOCK_SIZE at a time and converted with the
+//! GeonavBatch kernels, while the iterator still hands them out one by one
+//! (so the views are single pass, reading ahead of the iterator).
+//! With C++20 the views model std::ranges::view, so they compose with the
+//! standard adaptors (e.g. | std::views::filter(...)).  Otherwise they are
+//! plain input ranges usable with range-for and the <algorithm> functions.
+//!
+namespace GeonavTransform
+{
+namespace GeonavRanges
+{
+  //! @brief Geographic position [dec. degrees, m]
+  //!
+  struct GeoPoint
+  {
+    double latitude;
+    double longitude;
+    double altitude;
+  };
+
+  //! @brief Position in the local (odom) frame of a datum [m]
+  //!
+  struct LocalPoint
+  {
+    double x;
+    double y;
+    double z;
+  };
+
+  //! @brief Number of elements converted at once
+  //!
+  const size_t BLOCK_SIZE = 8;
+
+  //! @brief Access to the coordinates of a range element
+  //!
+  //! Specialize for your own track/point types to use them with toLocal().
+  //!
+  template <typename T>
+  struct GeoPointTraits
+  {
+    static double latitude(const T &p) { return p.latitude; }
+    static double longitude(const T &p) { return p.longitude; }
+    static double altitude(const T &p) { return p.altitude; }
+  };
+
+  template <typename T>
+  struct LocalPointTraits
+  {
+    static double x(const T &p) { return p.x; }
+    static double y(const T &p) { return p.y; }
+    static double z(const T &p) { return p.z; }
+  };
+
+  //! @brief Conversion policy for toLocal()
+  //!
+  struct ToLocalOp
+  {
+    typedef LocalPoint value_type;
+
+    template <typename T>
+    static void load(const T &in, double &a, double &b, double &c)
+    {
+      a = GeoPointTraits<T>::latitude(in);
+      b = GeoPointTraits<T>::longitude(in);
+      c = GeoPointTraits<T>::altitude(in);
+    }
+
+    static void convert(const GeonavBatch::Datum &datum,
+                        const double *a, const double *b, const double *c,
+                        size_t count, value_type *out)
+    {
+      double x[BLOCK_SIZE];
+      double y[BLOCK_SIZE];
+      GeonavBatch::LLtoLocal(datum, a, b, count, x, y);
+      for (size_t i = 0; i < count; ++i)
+      {
+        out[i].x = x[i];
+        out[i].y = y[i];
+        out[i].z = c[i] - datum.altitude;
+      }
+    }
+  };
+
+  //! @brief Conversion policy for toGeo()
+  //!
+  struct ToGeoOp
+  {
+    typedef GeoPoint value_type;
+
+    template <typename T>
+    static void load(const T &in, double &a, double &b, double &c)
+    {
+      a = LocalPointTraits<T>::x(in);
+      b = LocalPointTraits<T>::y(in);
+      c = LocalPointTraits<T>::z(in);
+    }
+
+    static void convert(const GeonavBatch::Datum &datum,
+                        const double *a, const double *b, const double *c,
+                        size_t count, value_type *out)
+    {
+      double lat[BLOCK_SIZE];
+      double lon[BLOCK_SIZE];
+      GeonavBatch::LocalToLL(datum, a, b, count, lat, lon);
+      for (size_t i = 0; i < count; ++i)
+      {
+        out[i].latitude = lat[i];
+        out[i].longitude = lon[i];
+        out[i].altitude = c[i] + datum.altitude;
+      }
+    }
+  };
+
+  //! @brief Lazy view converting the elements of an underlying range
+  //!
+  //! Single pass: the iterator holds one base iterator, which it advances
+  //! while filling its block, so elements are read from the base up to
+  //! BLOCK_SIZE ahead of the element being handed out.  The base only
+  //! needs to be an input range; it must tolerate that read-ahead (e.g.,
+  //! not be advanced by someone else while the view is iterated).
+  //!
+  //! With C++20 the base is a std::views::all_t, held by value, so views
+  //! and rvalue ranges can be piped in.  Otherwise it is a referenced
+  //! lvalue range.
+  //!
+  template <typename Range, typename Op>
+  class ConvertView
+#if __cplusplus >= 202002L
+    : public std::ranges::view_base
+#endif
+  {
+    public:
+      typedef typename Op::value_type value_type;
+#if __cplusplus >= 202002L
+      typedef std::ranges::iterator_t<Range> base_iterator;
+      typedef std::ranges::sentinel_t<Range> base_sentinel;
+#else
+      typedef decltype(std::begin(std::declval<Range &>())) base_iterator;
+      typedef base_iterator base_sentinel;
+#endif
+
+      //! @brief End of the view (C++20; before that end() is an iterator)
+      //!
+      struct sentinel
+      {
+        base_sentinel end;
+      };
+
+      class iterator
+      {
+        public:
+          typedef std::input_iterator_tag iterator_category;
+#if __cplusplus >= 202002L
+          typedef std::input_iterator_tag iterator_concept;
+#endif
+          typedef typename Op::value_type value_type;
+          typedef std::ptrdiff_t difference_type;
+          typedef const value_type *pointer;
+          typedef const value_type &reference;
+
+          iterator() : pos_(0), filled_(0) {}
+
+          iterator(const GeonavBatch::Datum &datum,
+                   base_iterator next, base_sentinel end) :
+            datum_(datum), next_(next), end_(end), pos_(0), filled_(0)
+          {
+            fill();
+          }
+
+          reference operator*() const { return block_[pos_]; }
+          pointer operator->() const { return &block_[pos_]; }
+
+          iterator &operator++()
+          {
+            if (++pos_ == filled_)
+            {
+              fill();
+            }
+            return *this;
+          }
+
+          iterator operator++(int)
+          {
+            iterator tmp = *this;
+            ++*this;
+            return tmp;
+          }
+
+          //! @brief Same position: same base position and the same number
+          //! of converted elements left in the block
+          bool operator==(const iterator &other) const
+          {
+            return next_ == other.next_ &&
+              filled_ - pos_ == other.filled_ - other.pos_;
+          }
+          bool operator!=(const iterator &other) const { return !(*this == other); }
+
+          bool operator==(const sentinel &s) const
+          {
+            return pos_ == filled_ && next_ == s.end;
+          }
+#if __cplusplus < 202002L
+          bool operator!=(const sentinel &s) const { return !(*this == s); }
+#endif
+
+        private:
+          //! @brief Convert the next block of the underlying range
+          void fill()
+          {
+            double a[BLOCK_SIZE];
+            double b[BLOCK_SIZE];
+            double c[BLOCK_SIZE];
+            size_t n = 0;
+            for (; n < BLOCK_SIZE && next_ != end_; ++n, ++next_)
+            {
+              Op::load(*next_, a[n], b[n], c[n]);
+            }
+            if (n > 0)
+            {
+              Op::convert(datum_, a, b, c, n, block_);
+            }
+            pos_ = 0;
+            filled_ = n;
+          }
+
+          GeonavBatch::Datum datum_;
+          //! @brief Underlying position of the first unconverted element
+          base_iterator next_;
+          base_sentinel end_;
+          value_type block_[BLOCK_SIZE];
+          size_t pos_;
+          size_t filled_;
+      };
+
+#if __cplusplus >= 202002L
+      ConvertView() = default;
+
+      ConvertView(Range base, const GeonavBatch::Datum &datum) :
+        base_(std::move(base)), datum_(datum)
+      {
+      }
+
+      iterator begin()
+      {
+        return iterator(datum_, std::ranges::begin(base_), std::ranges::end(base_));
+      }
+
+      sentinel end()
+      {
+        sentinel s = {std::ranges::end(base_)};
+        return s;
+      }
+
+    private:
+      Range base_;
+      GeonavBatch::Datum datum_;
+#else
+      ConvertView() : range_(NULL) {}
+
+      ConvertView(Range &range, const GeonavBatch::Datum &datum) :
+        range_(&range), datum_(datum)
+      {
+      }
+
+      iterator begin() const
+      {
+        return iterator(datum_, std::begin(*range_), std::end(*range_));
+      }
+
+      iterator end() const
+      {
+        return iterator(datum_, std::end(*range_), std::end(*range_));
+      }
+
+    private:
+      //! @brief Non-owning, like std::ranges::ref_view
+      Range *range_;
+      GeonavBatch::Datum datum_;
+#endif
+  };
+
+  //! @brief Pipeable adaptor object returned by toLocal() and toGeo()
+  //!
+  template <typename Op>
+  struct ConvertAdaptor
+  {
+    GeonavBatch::Datum datum;
+  };
+
+  //! @brief Lazily convert geographic elements to the datum's local frame
+  //!
+  inline ConvertAdaptor<ToLocalOp> toLocal(const GeonavBatch::Datum &datum)
+  {
+    ConvertAdaptor<ToLocalOp> adaptor = {datum};
+    return adaptor;
+  }
+
+  //! @brief Lazily convert local frame elements to geographic
+  //!
+  inline ConvertAdaptor<ToGeoOp> toGeo(const GeonavBatch::Datum &datum)
+  {
+    ConvertAdaptor<ToGeoOp> adaptor = {datum};
+    return adaptor;
+  }
+
+#if __cplusplus >= 202002L
+  //! @brief range | toLocal(datum), range | toGeo(datum)
+  //!
+  //! Any viewable range: containers are referenced (or owned, if
+  //! rvalues) and views are held by value, as with std::views::all, so
+  //! e.g. tracks | std::views::take(5) | toLocal(datum) works.
+  //!
+  template <typename R, typename Op>
+    requires std::ranges::viewable_range<R>
+  ConvertView<std::views::all_t<R>, Op> operator|(R &&range,
+                                                  const ConvertAdaptor<Op> &adaptor)
+  {
+    return ConvertView<std::views::all_t<R>, Op>(
+      std::views::all(std::forward<R>(range)), adaptor.datum);
+  }
+#else
+  //! @brief range | toLocal(datum), range | toGeo(datum)
+  //!
+  //! The range is referenced, not copied, and must outlive the view.
+  //!
+  template <typename Range, typename Op>
+  ConvertView<Range, Op> operator|(Range &range, const ConvertAdaptor<Op> &adaptor)
+  {
+    return ConvertView<Range, Op>(range, adaptor.datum);
+  }
+#endif
+
+  //! @brief Convert [first, last) into an output iterator
+  //!
+  //! Equivalent to std::copy over the view, e.g.
+  //!   convertCopy(in.begin(), in.end(), out, toLocal(datum));
+  //! Conversion runs in blocks on the stack; nothing is allocated.
+  //!
+  template <typename InputIt, typename OutputIt, typename Op>
+  OutputIt convertCopy(InputIt first, InputIt last, OutputIt out,
+                       const ConvertAdaptor<Op> &adaptor)
+  {
+    double a[BLOCK_SIZE];
+    double b[BLOCK_SIZE];
+    double c[BLOCK_SIZE];
+    typename Op::value_type block[BLOCK_SIZE];
+    while (first != last)
+    {
+      size_t n = 0;
+      for (; n < BLOCK_SIZE && first != last; ++n, ++first)
+      {
+        Op::load(*first, a[n], b[n], c[n]);
+      }
+      Op::convert(adaptor.datum, a, b, c, n, block);
+      for (size_t i = 0; i < n; ++i)
+      {
+        *out++ = block[i];
+      }
+    }
+    return out;
+  }
+
+}  // namespace GeonavRanges
+}  // namespace GeonavTransform
+
+#endif  // GEONAV_TRANSFORM_GEONAV_RANGES_H
@@ -0,0 +1,156 @@
+/*
+
+Copyright (c) 2017, Brian Bingham
+All rights reserved
+
+This file is part of the geonav_transform package.
+
+Geonav_transform is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Geonav_transform is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this package.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef GEONAV_TRANSFORM_GEONAV_RASTER_H
+#define GEONAV_TRANSFORM_GEONAV_RASTER_H
+
+#include "geonav_transform/geonav_batch.h"
+#include "geonav_transform/geonav_batch_async.h"
+
+#include <cstddef>
+#include <future>
+#include <limits>
+#include <stdint.h>
+
+//! Reprojection of geographic rasters (charts, bathymetry) into grids in
+//! the local frame of a datum
+//!
+//! The inverse projection is smooth, so it is evaluated exactly only on a
+//! sparse control grid; source coordinates in between are interpolated,
+//! incrementally along each row.  Sampling runs over square tiles, on the
+//! ThreadPool with reprojectAsync().
+//!
+namespace GeonavTransform
+{
+namespace GeonavRaster
+{
+  //! @brief Geographic raster, row-major with row 0 at the north edge
+  //!
+  struct GeoRaster
+  {
+    GeoRaster() :
+      data(NULL), width(0), height(0), west(0.0), north(0.0),
+      cell_lon(0.0), cell_lat(0.0),
+      nodata(std::numeric_limits<float>::quiet_NaN())
+    {
+    }
+
+    const float *data;
+    size_t width;
+    size_t height;
+    //! @brief Longitude of the west edge, latitude of the north edge
+    //! [dec. degrees]
+    double west;
+    double north;
+    //! @brief Cell size [dec. degrees]
+    double cell_lon;
+    double cell_lat;
+    //! @brief Value of missing cells, in addition to NaN
+    float nodata;
+  };
+
+  //! @brief Grid in the local frame of a datum
+  //!
+  //! Laid out like nav_msgs/OccupancyGrid (row-major, row 0 at origin_y,
+  //! x along the rows), without rotation.
+  //!
+  struct LocalGrid
+  {
+    //! @brief Corner of cell (0, 0) [m]
+    double origin_x;
+    double origin_y;
+    //! @brief Cell size [m]
+    double resolution;
+    size_t width;
+    size_t height;
+  };
+
+  enum Interpolation
+  {
+    INTERPOLATE_NEAREST,
+    INTERPOLATE_BILINEAR
+  };
+
+  struct ReprojectOptions
+  {
+    ReprojectOptions() :
+      control_spacing(16), tile_size(64),
+      interpolation(INTERPOLATE_BILINEAR)
+    {
+    }
+
+    //! @brief Grid cells between exactly projected control points
+    //!
+    //! The interpolation error is far below a cell for any chart sized
+    //! grid; 1 projects every cell.
+    size_t control_spacing;
+    //! @brief Width and height of the tiles sampled per task [cells]
+    size_t tile_size;
+    Interpolation interpolation;
+  };
+
+  //! @brief Reproject a raster into a local grid
+  //!
+  //! Grid cells outside the raster, or sampling only missing raster cells,
+  //! are NaN; all of them are for an empty raster.
+  //!
+  //! @param[in] datum - origin of the local frame
+  //! @param[in] raster - source raster
+  //! @param[in] grid - output grid layout
+  //! @param[out] out - grid.width * grid.height values
+  //!
+  void reproject(const GeonavBatch::Datum &datum, const GeoRaster &raster,
+                 const LocalGrid &grid, float *out,
+                 const ReprojectOptions &options = ReprojectOptions());
+
+  //! @brief Asynchronous reproject(), one tile per task
+  //!
+  //! The raster data and out must stay valid until the batch completes.
+  //! batch.chunk_size is the number of grid cells per task, rounded to
+  //! whole tiles.
+  //! @return future holding the number of tiles sampled
+  //!
+  std::future<size_t> reprojectAsync(
+    const GeonavBatch::Datum &datum, const GeoRaster &raster,
+    const LocalGrid &grid, float *out,
+    const ReprojectOptions &options = ReprojectOptions(),
+    const GeonavBatch::BatchOptions &batch = GeonavBatch::BatchOptions());
+  void reprojectAsync(
+    const GeonavBatch::Datum &datum, const GeoRaster &raster,
+    const LocalGrid &grid, float *out,
+    const ReprojectOptions &options,
+    const GeonavBatch::BatchCallback &done,
+    const GeonavBatch::BatchOptions &batch = GeonavBatch::BatchOptions());
+
+  //! @brief Map values to nav_msgs/OccupancyGrid cells
+  //!
+  //! free_value maps to 0 and occupied_value to 100, linearly and clamped;
+  //! NaN maps to -1 (unknown).  For depths, free_value is the safe depth
+  //! and occupied_value the shallow one.
+  //!
+  void toOccupancy(const float *values, size_t count,
+                   float free_value, float occupied_value, int8_t *out);
+
+}  // namespace GeonavRaster
+}  // namespace GeonavTransform
+
+#endif  // GEONAV_TRANSFORM_GEONAV_RASTER_H
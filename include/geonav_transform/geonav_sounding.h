@@ -0,0 +1,141 @@
+/*
+
+Copyright (c) 2017, Brian Bingham
+All rights reserved
+
+This file is part of the geonav_transform package.
+
+Geonav_transform is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Geonav_transform is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this package.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef GEONAV_TRANSFORM_GEONAV_SOUNDING_H
+#define GEONAV_TRANSFORM_GEONAV_SOUNDING_H
+
+#include "geonav_transform/geonav_batch.h"
+#include "geonav_transform/geonav_pose_history.h"
+
+#include <cstddef>
+#include <vector>
+
+namespace GeonavTransform
+{
+
+//! @brief Georeferencing of multibeam / sonar soundings
+//!
+//! Combines the vehicle pose at the time of each beam (from a PoseHistory
+//! in the datum's local frame), the attitude, the sonar lever arm and
+//! mounting rotation, and the projection to lat/lon, one ping at a time.
+//! Beam geometry is computed in branch-free loops over the ping; each
+//! distinct beam time is interpolated once.
+//!
+class SoundingGeoreferencer
+{
+  public:
+    //! @brief Beams of one ping in the sonar frame
+    //!
+    //! The sonar frame is x forward, y to port, z up; a beam with zero
+    //! angles points straight down.
+    //!
+    struct Ping
+    {
+      Ping() :
+        stamp(0.0), count(0), range(NULL), across(NULL), along(NULL),
+        time_offset(NULL)
+      {
+      }
+
+      //! @brief Time of the ping [s]
+      double stamp;
+      size_t count;
+      //! @brief Slant range of each beam [m]
+      const float *range;
+      //! @brief Across-track angle, positive to port [rad]
+      const float *across;
+      //! @brief Along-track angle, positive forward [rad]; NULL for 0
+      const float *along;
+      //! @brief Time of each beam relative to stamp [s]; NULL for 0
+      const float *time_offset;
+    };
+
+    //! @brief Output arrays, ping.count long
+    //!
+    //! x, y and z, in the local frame, are required.  The geographic
+    //! outputs may be NULL (latitude and longitude are written together).
+    //! Beams without a vehicle pose are NaN.
+    //!
+    struct Soundings
+    {
+      Soundings() :
+        x(NULL), y(NULL), z(NULL), latitude(NULL), longitude(NULL),
+        altitude(NULL)
+      {
+      }
+
+      double *x;
+      double *y;
+      double *z;
+      double *latitude;
+      double *longitude;
+      double *altitude;
+    };
+
+    //! @brief Constructor
+    //! @param[in] history_size - vehicle poses kept for interpolation
+    //!
+    explicit SoundingGeoreferencer(size_t history_size = 512);
+
+    //! @brief Set the datum of the local frame
+    //!
+    //! Clears the pose history, which was in the old frame.
+    //!
+    void setDatum(const GeonavBatch::Datum &datum);
+
+    //! @brief Set the sonar pose in base_link
+    //! @param[in] x, y, z - lever arm [m]
+    //! @param[in] roll, pitch, yaw - mounting rotation [rad]
+    //!
+    void setMount(double x, double y, double z,
+                  double roll, double pitch, double yaw);
+
+    //! @brief Largest gap between vehicle poses to interpolate across [s]
+    //!
+    void setMaxGap(double max_gap);
+
+    //! @brief Add a base_link pose in the local frame
+    //! @return false if it is older than the latest pose
+    //!
+    bool addPose(const PoseHistory::Sample &pose);
+
+    //! @brief Georeference one ping
+    //! @return number of beams georeferenced
+    //!
+    size_t georeference(const Ping &ping, const Soundings &out) const;
+
+    const PoseHistory &history() const;
+
+  private:
+    GeonavBatch::Datum datum_;
+    PoseHistory history_;
+    double max_gap_;
+    //! @brief Sonar lever arm and rotation (row-major) in base_link
+    double lever_arm_[3];
+    double mount_[9];
+    //! @brief Beam vectors in base_link, reused between pings
+    mutable std::vector<double> scratch_;
+};
+
+}  // namespace GeonavTransform
+
+#endif  // GEONAV_TRANSFORM_GEONAV_SOUNDING_H
@@ -0,0 +1,118 @@
+/*
+
+Copyright (c) 2017, Brian Bingham
+All rights reserved
+
+This file is part of the geonav_transform package.
+
+Geonav_transform is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Geonav_transform is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this package.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef GEONAV_TRANSFORM_GEONAV_THREAD_POOL_H
+#define GEONAV_TRANSFORM_GEONAV_THREAD_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace GeonavTransform
+{
+
+//! @brief Fixed size work-stealing thread pool
+//!
+//! Each worker owns a task deque.  Tasks submitted from outside the pool are
+//! dealt round-robin, tasks submitted by a worker go to its own deque.  Idle
+//! workers take from the back of their own deque and steal from the front of
+//! the others, so uneven chunks still keep every thread busy.
+//!
+class ThreadPool
+{
+  public:
+    typedef std::function<void()> Task;
+
+    //! @brief Constructor
+    //! @param[in] num_threads - number of workers, 0 for one per hardware thread
+    //!
+    explicit ThreadPool(size_t num_threads = 0);
+
+    //! @brief Destructor - runs the queued tasks, then joins the workers
+    //!
+    ~ThreadPool();
+
+    //! @brief Queue a task for execution
+    //!
+    void submit(const Task &task);
+
+    //! @brief Number of worker threads
+    //!
+    size_t size() const;
+
+    //! @brief Process wide pool used by the batch conversions
+    //!
+    static ThreadPool &shared();
+
+    //! @brief Set the number of workers of the shared pool
+    //!
+    //! Only effective before the first call to shared().
+    //!
+    static void setSharedConcurrency(size_t num_threads);
+
+  private:
+    ThreadPool(const ThreadPool &);
+    ThreadPool &operator=(const ThreadPool &);
+
+    //! @brief Per-worker task queue
+    //!
+    struct Worker
+    {
+      std::mutex mutex;
+      std::deque<Task> tasks;
+    };
+
+    //! @brief Worker thread body
+    //!
+    void workerLoop(size_t index);
+
+    //! @brief Pop from our own queue, otherwise steal from another worker
+    //!
+    bool takeTask(size_t index, Task &task);
+
+    std::vector<std::unique_ptr<Worker> > workers_;
+    std::vector<std::thread> threads_;
+
+    //! @brief Wakes idle workers when tasks are queued
+    //!
+    std::mutex wake_mutex_;
+    std::condition_variable wake_;
+
+    //! @brief Number of queued tasks not yet taken by a worker
+    //!
+    std::atomic<long> pending_;
+
+    //! @brief Round-robin cursor for external submissions
+    //!
+    std::atomic<size_t> next_worker_;
+
+    bool stop_;
+};
+
+}  // namespace GeonavTransform
+
+#endif  // GEONAV_TRANSFORM_GEONAV_THREAD_POOL_H
@@ -24,10 +24,35 @@ along with Foobar.  If not, see <http://www.gnu.org/licenses/>.
 #define GEONAV_TRANSFORM_GEONAV_TRANSFORM_H
 
 #include <ros/ros.h>
-
+#include <dynamic_reconfigure/server.h>
+
+#include <geonav_transform/CoverageTiles.h>
+#include <geonav_transform/GeofenceStatus.h>
+#include <geonav_transform/GeonavTransformConfig.h>
+#include <geonav_transform/MissionPathStatus.h>
+#include <geonav_transform/OdometryBatch.h>
+#include <geonav_transform/SonarPing.h>
+#include <geonav_transform/Soundings.h>
+
+#include <geographic_msgs/GeoPath.h>
+#include <geometry_msgs/PoseArray.h>
+#include <geometry_msgs/TransformStamped.h>
 #include <nav_msgs/Odometry.h>
+#include <nav_msgs/Path.h>
 #include <sensor_msgs/Imu.h>
 #include <sensor_msgs/NavSatFix.h>
+#include <std_msgs/Bool.h>
+#include <std_msgs/Float64.h>
+#include <tf2_msgs/TFMessage.h>
+
+#include "geonav_transform/geonav_batch.h"
+#include "geonav_transform/geonav_coverage.h"
+#include "geonav_transform/geonav_geodesic.h"
+#include "geonav_transform/geonav_geofence.h"
+#include "geonav_transform/geonav_mission_path.h"
+#include "geonav_transform/geonav_pose_history.h"
+#include "geonav_transform/geonav_sounding.h"
+#include "geonav_transform/geonav_utilities.h"
 
 #include <tf2/LinearMath/Transform.h>
 #include <tf2_ros/static_transform_broadcaster.h>
@@ -37,7 +62,10 @@ along with Foobar.  If not, see <http://www.gnu.org/licenses/>.
 
 #include <Eigen/Dense>
 
+#include <atomic>
+#include <memory>
 #include <string>
+#include <vector>
 
 namespace GeonavTransform
 {
@@ -58,6 +86,148 @@ class GeonavTransform
     void run();
 
   private:
+    //! @brief Parameters that can be changed at runtime
+    //!
+    //! Never modified once published; see settings_.
+    //!
+    struct Settings
+    {
+      //! @brief Frequency of broadcasting the odom->base_link transform [Hz]
+      double frequency;
+      //! @brief Whether or not to report 0 altitude
+      //!
+      //! If this parameter is true, we always report 0 for the altitude of the converted GPS odometry message.
+      //!
+      bool zero_altitude;
+      //! @brief Whether or not convert from NED to ENU
+      bool orientation_ned;
+      //! @brief Whether or not we broadcast the utm->odom transform
+      bool broadcast_utm2odom_transform;
+      //! @brief Whether or not we broadcast the odom->base_link transform
+      bool broadcast_odom2base_transform;
+      //! @brief Maximum rates of geonav_utm, geonav_odom and geonav_geo,
+      //! 0 for every message [Hz]
+      double utm_rate;
+      double odom_rate;
+      double geo_rate;
+    };
+
+    //! @brief Additional odom frame anchored at a named datum
+    //!
+    //! All datums share the fix's projection into the primary datum's UTM
+    //! zone, so each one only applies its own offset and yaw.
+    //!
+    struct NamedDatum
+    {
+      //! @brief Frame ID, the datum name with the tf prefix
+      std::string frame_id;
+      //! @brief Pose of the datum frame in the utm frame, and its inverse
+      tf2::Transform transform_utm2datum;
+      tf2::Transform transform_datum2utm;
+      //! @brief Messages
+      geometry_msgs::TransformStamped transform_msg;
+      nav_msgs::Odometry nav_in_datum;
+      ros::Publisher pub;
+    };
+
+    //! @brief Current settings snapshot
+    //!
+    //! Callbacks take one pointer per message and use it throughout, so
+    //! they see a consistent set even if a reconfigure happens meanwhile.
+    //! The snapshot stays valid for the lifetime of the node.
+    //!
+    const Settings *settings() const;
+
+    //! @brief dynamic_reconfigure callback, publishes a new settings snapshot
+    //!
+    void reconfigureCallback(geonav_transform::GeonavTransformConfig &config,
+                             uint32_t level);
+
+    //! @brief Sends the static utm->odom transform, if enabled
+    //!
+    void sendUtm2OdomTransform(const Settings &settings);
+
+    //! @brief Loads the ~datums parameter into datums_
+    //!
+    //! Must be called after setDatum, since the datums are projected into
+    //! the primary datum's zone.
+    //!
+    void loadDatums(ros::NodeHandle &nh, ros::NodeHandle &nh_priv,
+                    const std::string &tf_prefix);
+
+    //! @brief Publishes the latest base pose relative to each named datum
+    //!
+    void publishDatums(const Settings &settings);
+
+    //! @brief Loads the ~geofence parameter, projecting the polygons once
+    //! into the odom frame
+    //!
+    void loadGeofence(ros::NodeHandle &nh, ros::NodeHandle &nh_priv);
+
+    //! @brief Checks the latest base_link position against the geofence
+    //!
+    void checkGeofence(void);
+
+    //! @brief Callback for a new mission path, replacing the current one
+    //! @param[in] msg The waypoints
+    //!
+    void missionPathCallback(const geographic_msgs::GeoPathConstPtr& msg);
+
+    //! @brief Publishes the latest base_link position relative to the
+    //! mission path
+    //!
+    void trackMissionPath(void);
+
+    //! @brief Callback for the ship (moving datum) nav odometry
+    //!
+    //! Projects the ship's fix once into the datum's zone, stores it in
+    //! ship_history_ and broadcasts utm->ship.
+    //!
+    //! @param[in] msg The ship's odometry, organized like the nav odometry
+    //!
+    void shipOdomCallback(const nav_msgs::OdometryConstPtr& msg);
+
+    //! @brief Loads the ~sonar parameters and sets up the sounding
+    //! georeferencing, if ~soundings is set
+    //!
+    //! Must be called after setDatum.
+    //!
+    void loadSoundings(ros::NodeHandle &nh, ros::NodeHandle &nh_priv);
+
+    //! @brief Callback for a sonar ping, published as georeferenced
+    //! soundings
+    //!
+    //! @param[in] msg The beams, in the sonar frame
+    //!
+    void sonarPingCallback(const geonav_transform::SonarPingConstPtr& msg);
+
+    //! @brief Loads the ~coverage parameters and sets up the coverage
+    //! grid, if ~coverage/enable is set
+    //!
+    void loadCoverage(ros::NodeHandle &nh, ros::NodeHandle &nh_priv);
+
+    //! @brief Callback for a new swath width [m]
+    //!
+    void swathWidthCallback(const std_msgs::Float64ConstPtr& msg);
+
+    //! @brief Timer callback, publishes the coverage tiles changed since
+    //! the last call (or all of them every ~coverage/full_period)
+    //!
+    void coverageTimerCallback(const ros::TimerEvent &event);
+
+    //! @brief Publishes the latest base pose relative to the ship, using
+    //! the ship pose interpolated at the time of the vehicle fix
+    //!
+    void publishShip(const ros::Time &stamp, const Settings &settings);
+
+    //! @brief Sends static utm->utm_<zone> transforms for the zones east and
+    //! west of the datum's
+    //!
+    //! A rigid fit at the datum (GeonavBatch::zoneTransform), so consumers
+    //! can move nearby cross-zone data with one cached transform.
+    //!
+    void sendNeighbourZoneTransforms(void);
+
     //! @brief Computes the transform from the UTM frame to the odom frame
     //!
     void computeTransformOdom2Utm();
@@ -82,19 +252,99 @@ class GeonavTransform
                                  const ros::Time &transform_time);
 
 
+    //! @brief Refreshes the cached nav->base_link offset if it is stale
+    //!
+    //! Only looks up the transform after the nav frame_id or /tf_static
+    //! changed, so the per-message cost is a flag check.
+    //!
+    void updateLeverArm();
+
+    //! @brief Whether tf_buffer_ holds every transform in lever_arm_pending_
+    //!
+    bool leverArmPendingApplied();
+
+    //! @brief Callback for /tf_static, marks the lever arm cache stale
+    //! until tf_buffer_ has the new transforms
+    //! @param[in] msg The static transforms
+    //!
+    void tfStaticCallback(const tf2_msgs::TFMessageConstPtr& msg);
+
     //! @brief Callback for the geo nav odom data
     //! @param[in] msg The odometry message to process
     //!
     void navOdomCallback(const nav_msgs::OdometryConstPtr& msg);
 
+    //! @brief Converts a NAV message to the utm and odom frames
+    //!
+    //! Updates the utm/odom->base transforms and the nav_in_utm_ and
+    //! nav_in_odom_ messages (except header.seq).
+    //!
+    void convertNav(const nav_msgs::Odometry &msg, const Settings &settings);
+
+    //! @brief Appends the latest utm-frame conversion to the batch output
+    //!
+    //! Publishes the batch when it is full or its window has elapsed.
+    //!
+    void appendBatch(void);
+
+    //! @brief Publishes and empties the batch, keeping its storage
+    //!
+    void flushBatch(void);
+
     //! @brief Callback for odom in geo frame
     //! @param[in] msg The odometry message to process
     //!
     void geoOdomCallback(const nav_msgs::OdometryConstPtr& msg);
 
+    //! @brief Callback for a path of geo poses, e.g., tracked contacts
+    //!
+    //! Converted in one pass with the batch kernels and published as a
+    //! nav_msgs/Path in the odom frame.  With ~path_spacing or
+    //! ~path_tolerance set, the legs are densified along geodesics.
+    //!
+    //! @param[in] msg The path to process
+    //!
+    void geoPathCallback(const geographic_msgs::GeoPathConstPtr& msg);
+
+    //! @brief Callback for an array of geo poses
+    //!
+    //! Position is organized as in the nav odometry (x = longitude,
+    //! y = latitude, z = altitude).  Published as a PoseArray in the odom
+    //! frame.
+    //!
+    //! @param[in] msg The poses to process
+    //!
+    void geoPoseArrayCallback(const geometry_msgs::PoseArrayConstPtr& msg);
+
+    //! @brief Converts the first count array_lat_/array_lon_ to array_x_/array_y_
+    //!
+    //! All buffers are resized, keeping their capacity, so the callbacks
+    //! stop allocating once the largest array has been seen.
+    //!
+    void convertArrays(size_t count);
+
     //! @brief Sends transform
     void broadcastTf(void);
 
+    //! @brief Timer callback, sends transform at the requested frequency
+    //!
+    void tfTimerCallback(const ros::TimerEvent &event);
+
+    //! @brief One-shot timer callback, fires when nav input may be stale
+    //!
+    //! Re-arms itself for the remaining time if a message arrived since it
+    //! was armed, so the message path never has to touch the timer.
+    //!
+    void watchdogCallback(const ros::TimerEvent &event);
+
+    //! @brief (Re)starts the watchdog timer
+    //!
+    void armWatchdog(const ros::Duration &timeout);
+
+    //! @brief Publishes nav_healthy_ on the health topic
+    //!
+    void publishHealth(void);
+
     //! @brief Frame ID of the robot's body frame
     //!
     std::string base_link_frame_id_;
@@ -107,21 +357,40 @@ class GeonavTransform
     //!
     std::string utm_frame_id_;
 
-    //! @brief Whether or not we broadcast the utm->odom transform
+    //! @brief Runtime parameters
+    //!
+    //! Replaced, never modified, by reconfigureCallback.  Readers load the
+    //! pointer with acquire ordering, a plain lock-free load, so they never
+    //! block or see a half-updated set.  Snapshots are reclaimed with the
+    //! node (see settings_history_), so no reader can be left holding a
+    //! freed one.
+    //!
+    std::atomic<const Settings *> settings_;
+
+    //! @brief Owns every snapshot published to settings_
+    //!
+    //! Only touched by reconfigureCallback.  A snapshot is a few dozen
+    //! bytes, so keeping them all costs little even with a slider dragged
+    //! in rqt_reconfigure.
     //!
-    bool broadcast_utm2odom_transform_;
+    std::vector<std::unique_ptr<const Settings> > settings_history_;
 
-    //! @brief Whether or not we broadcast the odom->base_link transform
+    //! @brief dynamic_reconfigure server for settings_
     //!
-    bool broadcast_odom2base_transform_;
+    std::unique_ptr<dynamic_reconfigure::Server<geonav_transform::GeonavTransformConfig> >
+      reconfigure_server_;
 
-    //! @brief Whether or not convert from NED to ENU
+    //! @brief Resolved frame IDs
     //!
-    bool orientation_ned_;
+    GeonavUtilities::FrameIdTable frame_ids_;
+    GeonavUtilities::FrameIdTable::Id base_link_frame_;
 
     //! @brief The frame_id of the NAV message (specifies mounting location)
     //!
+    //! As received; only copied and resolved to nav_frame_ when it changes.
+    //!
     std::string nav_frame_id_;
+    GeonavUtilities::FrameIdTable::Id nav_frame_;
 
     //! @brief Timestamp of the latest good NAV message
     //!
@@ -129,21 +398,109 @@ class GeonavTransform
     //!
     ros::Time nav_update_time_;
 
+    //! @brief Latest good NAV message, converted lazily
+    //!
+    nav_msgs::OdometryConstPtr latest_nav_;
+
+    //! @brief Whether latest_nav_ has been converted
+    //!
+    bool nav_converted_;
+
+    //! @brief Decimation of the geonav_utm, geonav_odom and geonav_geo outputs
+    //!
+    GeonavUtilities::RateLimiter utm_limiter_;
+    GeonavUtilities::RateLimiter odom_limiter_;
+    GeonavUtilities::RateLimiter geo_limiter_;
+
+    //! @brief Batch output being collected
+    //!
+    //! Cleared, not reallocated, after publishing, so its arrays keep their
+    //! capacity from one batch to the next.
+    //!
+    geonav_transform::OdometryBatch utm_batch_;
+
+    //! @brief Number of samples per batch, 0 for no limit
+    //!
+    int batch_size_;
+
+    //! @brief Time window of a batch [s], 0 for no limit
+    //!
+    //! Batching is disabled if both batch_size_ and batch_period_ are 0.
+    //!
+    double batch_period_;
+
+    //! @brief Time without NAV messages after which the input is stale [s]
+    //!
+    double nav_timeout_;
+
+    //! @brief Whether NAV messages are arriving; TF is only sent when true
+    //!
+    bool nav_healthy_;
+
+    //! @brief Timer for broadcasting TF
+    //!
+    ros::Timer tf_timer_;
+
+    //! @brief One-shot timer detecting stale NAV input
+    //!
+    ros::Timer watchdog_timer_;
+
     //! @brief Latest NAV data, stored as UTM coords
     //!
     tf2::Transform transform_utm2nav_;
     tf2::Transform transform_utm2nav_inverse_;
 
+    //! @brief Latest base_link pose, after removing the lever arm
+    //!
+    tf2::Transform transform_utm2base_;
+
   tf2::Transform transform_odom2nav_;
     tf2::Transform transform_odom2nav_inverse_;
 
     //! @brief Transform buffer for managing coordinate transforms
     //!
-    tf2_ros::Buffer tf_buffer_;
+    //! Only created when a feature needs transforms from /tf (currently
+    //! lever arm compensation), since the listener runs its own thread and
+    //! subscribes to all /tf traffic.
+    //!
+    std::unique_ptr<tf2_ros::Buffer> tf_buffer_;
 
     //! @brief Transform listener for receiving transforms
     //!
-    tf2_ros::TransformListener tf_listener_;
+    std::unique_ptr<tf2_ros::TransformListener> tf_listener_;
+
+    //! @brief Whether or not to remove the nav sensor offset from base_link
+    //!
+    bool lever_arm_compensation_;
+
+    //! @brief Cached static nav->base_link transform (the lever arm)
+    //!
+    tf2::Transform transform_nav2base_;
+
+    //! @brief Nav frame that transform_nav2base_ was looked up for
+    //!
+    GeonavUtilities::FrameIdTable::Id lever_arm_frame_;
+
+    //! @brief Whether transform_nav2base_ needs to be looked up again
+    //!
+    bool lever_arm_stale_;
+
+    //! @brief Earliest time to retry a failed lever arm lookup
+    //!
+    ros::Time lever_arm_retry_time_;
+
+    //! @brief Static transforms received on /tf_static that tf_buffer_
+    //! may not hold yet; the lever arm stays stale until it does
+    //!
+    std::vector<geometry_msgs::TransformStamped> lever_arm_pending_;
+
+    //! @brief When the oldest of lever_arm_pending_ was received
+    //!
+    ros::Time lever_arm_pending_since_;
+
+    //! @brief Subscriber to /tf_static, used to invalidate the lever arm
+    //!
+    ros::Subscriber tf_static_sub_;
 
     //! @brief Whether or not we've computed a good heading
     //!
@@ -178,11 +535,103 @@ class GeonavTransform
     //!
     std::string utm_zone_;
 
-    //! @brief Whether or not to report 0 altitude
+    //! @brief Datum as used by the batch kernels
+    //!
+    GeonavBatch::Datum datum_;
+
+    //! @brief Named datums in addition to the primary (odom) one
+    //!
+    std::vector<NamedDatum> datums_;
+
+    //! @brief Fence polygons in the odom frame
+    //!
+    Geofence geofence_;
+    geonav_transform::GeofenceStatus geofence_status_;
+
+    //! @brief Mission path in the odom frame
+    //!
+    MissionPath mission_path_;
+    geonav_transform::MissionPathStatus mission_status_;
+
+    //! @brief Whether or not to publish relative to a moving ship frame
+    //!
+    bool moving_datum_;
+
+    //! @brief Frame ID of the moving datum
+    //!
+    std::string ship_frame_id_;
+
+    //! @brief Recent ship poses in the utm frame, for time alignment
+    //!
+    PoseHistory ship_history_;
+
+    //! @brief Messages
+    geometry_msgs::TransformStamped transform_msg_utm2ship_;
+    nav_msgs::Odometry nav_in_ship_;
+
+    //! @brief Whether or not to georeference sonar pings
+    //!
+    bool soundings_;
+
+    //! @brief Recent base_link poses and the sonar mounting
+    //!
+    SoundingGeoreferencer sounding_georeferencer_;
+
+    //! @brief Soundings output, reused between pings
+    //!
+    geonav_transform::Soundings soundings_out_;
+
+    //! @brief Whether or not to map survey coverage
+    //!
+    bool coverage_;
+
+    //! @brief Coverage of the base_link swath and the soundings
+    //!
+    CoverageGrid coverage_grid_;
+
+    //! @brief Current swath width [m], 0 for the track only
+    //!
+    double coverage_swath_width_;
+
+    //! @brief Interval between messages with every tile [s]
+    //!
+    double coverage_full_period_;
+    ros::Time coverage_full_time_;
+
+    //! @brief Coverage output and encoding buffers, swapped between
+    //! messages so neither reallocates
+    //!
+    geonav_transform::CoverageTiles coverage_out_;
+    CoverageGrid::Encoded coverage_encoded_;
+
+    //! @brief Timer for publishing the coverage
+    //!
+    ros::Timer coverage_timer_;
+
+    //! @brief Whether or not to broadcast the neighbour zone frames
+    //!
+    bool neighbour_zone_frames_;
+
+    //! @brief Densification of geo_path legs along geodesics [m]
+    //!
+    //! Largest step and largest chord deviation, 0 to disable either.
+    //!
+    double path_spacing_;
+    double path_tolerance_;
+
+    //! @brief Scratch buffers for array conversions, reused between messages
     //!
-    //! If this parameter is true, we always report 0 for the altitude of the converted GPS odometry message.
+    std::vector<double> array_lat_;
+    std::vector<double> array_lon_;
+    std::vector<double> array_x_;
+    std::vector<double> array_y_;
+    //! @brief Leg parameter of each densified path point
+    std::vector<double> array_param_;
+
+    //! @brief Array outputs, reused between messages
     //!
-    bool zero_altitude_;
+    nav_msgs::Path path_in_odom_;
+    geometry_msgs::PoseArray pose_array_in_odom_;
 
     //! @brief Publisher of Nav relative to odom (datum) frame
     ros::Publisher odom_pub_;
@@ -190,6 +639,42 @@ class GeonavTransform
     ros::Publisher utm_pub_;
     //! @brief Publisher of Geo Odometry relative to geo frame
     ros::Publisher geo_pub_;
+    //! @brief Publisher of batched Nav Odometry relative to utm frame
+    ros::Publisher utm_batch_pub_;
+    //! @brief Publishers of converted geo arrays relative to odom frame
+    ros::Publisher path_pub_;
+    ros::Publisher pose_array_pub_;
+    //! @brief Publisher of the geofence state
+    ros::Publisher geofence_pub_;
+    //! @brief Publisher of the mission path tracking
+    ros::Publisher mission_pub_;
+    //! @brief Publisher of Nav Odometry relative to the ship frame
+    ros::Publisher ship_pub_;
+    //! @brief Publisher of the georeferenced soundings
+    ros::Publisher soundings_pub_;
+    //! @brief Publisher of the coverage grid
+    ros::Publisher coverage_pub_;
+    //! @brief Publisher of the (latched) NAV input health
+    ros::Publisher health_pub_;
+
+    //! @brief Subscriber to the NAV odometry
+    ros::Subscriber nav_odom_sub_;
+
+    //! @brief Subscriber to the ship (moving datum) odometry
+    ros::Subscriber ship_odom_sub_;
+
+    //! @brief Subscriber to the mission path
+    ros::Subscriber mission_path_sub_;
+
+    //! @brief Subscribers to the geo arrays
+    ros::Subscriber geo_path_sub_;
+    ros::Subscriber geo_pose_array_sub_;
+
+    //! @brief Subscriber to the sonar pings
+    ros::Subscriber sonar_ping_sub_;
+
+    //! @brief Subscriber to the swath width
+    ros::Subscriber swath_width_sub_;
 
 
 };
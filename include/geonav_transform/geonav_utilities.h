@@ -24,9 +24,13 @@ along with Foobar.  If not, see <http://www.gnu.org/licenses/>.
 
 #include <Eigen/Dense>
 
+#include <cstddef>
+#include <deque>
 #include <iomanip>
 #include <iostream>
+#include <stdint.h>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 
@@ -57,16 +61,121 @@ namespace GeonavUtilities
 {
 
   //! @brief Utility method keeping RPY angles in the range [-pi, pi]
+  //!
+  //! Constant time for any input; values already in range are returned
+  //! unchanged, and odd multiples of pi keep their sign (3 pi -> pi).
+  //!
   //! @param[in] rotation - The rotation to bind
   //! @return the bounded value
   //!
   double clampRotation(double rotation);
 
+  //! @brief Batch angle utilities
+  //!
+  //! Branch-free loops over plain arrays, in the style of the GeonavBatch
+  //! kernels, so the compiler can vectorize them.  Angles are in radians
+  //! and the output arrays may be the input arrays.
+  //!
+
+  //! @brief clampRotation() over an array
+  //!
+  void wrapAngles(const double *angles, size_t count, double *wrapped);
+
+  //! @brief Remove the 2*pi jumps from a sequence of angles (e.g., a heading
+  //! track) so it is continuous
+  //!
+  //! Each output differs from the previous one by the wrapped difference of
+  //! the inputs.  The first angle is kept as is.
+  //!
+  void unwrapAngles(const double *angles, size_t count, double *unwrapped);
+
+  //! @brief Yaw (ENU, about z) of quaternions [rad]
+  //!
+  //! Same as the yaw of tf2::Matrix3x3::getRPY away from pitch = +/-pi/2.
+  //!
+  void quaternionToYaw(const double *qx, const double *qy,
+                       const double *qz, const double *qw,
+                       size_t count, double *yaw);
+
+  //! @brief Quaternions of pure yaw rotations
+  //!
+  void yawToQuaternion(const double *yaw, size_t count,
+                       double *qx, double *qy, double *qz, double *qw);
+
   //! @brief Utility method for appending tf2 prefixes cleanly
   //! @param[in] tfPrefix - the tf2 prefix to append
   //! @param[in, out] frameId - the resulting frame_id value
   //!
-  void appendPrefix(std::string tfPrefix, std::string &frameId);
+  void appendPrefix(const std::string &tfPrefix, std::string &frameId);
+
+  //! @brief Interning table of resolved frame IDs
+  //!
+  //! resolve() strips/prefixes a frame_id once, as appendPrefix() does, and
+  //! maps the result to a small integer.  Repeated lookups of the same raw
+  //! name don't build any strings, and resolved frames compare as integers.
+  //! IDs stay valid for the lifetime of the table.
+  //!
+  class FrameIdTable
+  {
+    public:
+      typedef uint32_t Id;
+
+      //! @brief ID of the empty frame_id
+      static const Id EMPTY = 0;
+
+      FrameIdTable();
+
+      //! @brief ID of a frame_id after appending the tf prefix
+      //! @param[in] frameId - the frame_id as received, e.g., "/gps"
+      //! @param[in] tfPrefix - the tf2 prefix to append, may be empty
+      //! @return the ID, shared by all names resolving to the same frame
+      //!
+      Id resolve(const std::string &frameId, const std::string &tfPrefix = "");
+
+      //! @brief Resolved name of an ID
+      //!
+      //! The reference stays valid for the lifetime of the table.
+      //!
+      const std::string &name(Id id) const;
+
+      //! @brief Number of distinct resolved frames
+      //!
+      size_t size() const;
+
+    private:
+      typedef std::unordered_map<std::string, Id> NameMap;
+
+      //! @brief Raw name lookups, per tf prefix
+      std::unordered_map<std::string, NameMap> raw_;
+      //! @brief Resolved name -> ID
+      NameMap ids_;
+      //! @brief ID -> resolved name; a deque so references stay valid
+      std::deque<std::string> names_;
+  };
+
+  //! @brief Time based decimation of an output stream
+  //!
+  //! due() returns true at most once per 1/rate seconds.  Slots stay on a
+  //! fixed grid, so the average output rate matches the requested one even
+  //! with jittery input.  If time jumps back by more than a period, the
+  //! grid restarts at the new time.
+  //!
+  class RateLimiter
+  {
+    public:
+      RateLimiter();
+
+      //! @brief Whether the next output slot has been reached
+      //! @param[in] now - current time [s]
+      //! @param[in] rate - maximum output rate [Hz], <= 0 for no limit
+      //! @return true if the output should be produced now
+      //!
+      bool due(double now, double rate);
+
+    private:
+      //! @brief Start of the next output slot [s]
+      double next_;
+  };
 
 }  // namespace GeonavUtilities
 }  // namespace GeonavTranform
@@ -177,6 +177,30 @@ static inline char UTMLetterDesignator(double Lat)
   return LetterDesignator;
 }
 
+/**
+ * Determine the UTM zone number for the given latitude and longitude,
+ * including the special zones for southern Norway and Svalbard.
+ *
+ * Longitude must already be normalized to -180.00 .. 179.9
+ */
+static inline int UTMZoneNumber(const double Lat, const double Long)
+{
+  int ZoneNumber = static_cast<int>((Long + 180)/6) + 1;
+
+  if ( Lat >= 56.0 && Lat < 64.0 && Long >= 3.0 && Long < 12.0 )
+    ZoneNumber = 32;
+
+        // Special zones for Svalbard
+  if ( Lat >= 72.0 && Lat < 84.0 )
+  {
+    if (      Long >= 0.0  && Long <  9.0 ) ZoneNumber = 31;
+    else if ( Long >= 9.0  && Long < 21.0 ) ZoneNumber = 33;
+    else if ( Long >= 21.0 && Long < 33.0 ) ZoneNumber = 35;
+    else if ( Long >= 33.0 && Long < 42.0 ) ZoneNumber = 37;
+  }
+  return ZoneNumber;
+}
+
 /**
  * Convert lat/long to UTM coords.  Equations from USGS Bulletin 1532
  *
@@ -204,21 +228,8 @@ static inline void LLtoUTM(const double Lat, const double Long,
   double LatRad = Lat*RADIANS_PER_DEGREE;
   double LongRad = LongTemp*RADIANS_PER_DEGREE;
   double LongOriginRad;
-  int    ZoneNumber;
-
-  ZoneNumber = static_cast<int>((LongTemp + 180)/6) + 1;
-
-  if ( Lat >= 56.0 && Lat < 64.0 && LongTemp >= 3.0 && LongTemp < 12.0 )
-    ZoneNumber = 32;
+  int    ZoneNumber = UTMZoneNumber(Lat, LongTemp);
 
-        // Special zones for Svalbard
-  if ( Lat >= 72.0 && Lat < 84.0 )
-  {
-    if (      LongTemp >= 0.0  && LongTemp <  9.0 ) ZoneNumber = 31;
-    else if ( LongTemp >= 9.0  && LongTemp < 21.0 ) ZoneNumber = 33;
-    else if ( LongTemp >= 21.0 && LongTemp < 33.0 ) ZoneNumber = 35;
-    else if ( LongTemp >= 33.0 && LongTemp < 42.0 ) ZoneNumber = 37;
-  }
         // +3 puts origin in middle of zone
   LongOrigin = (ZoneNumber - 1)*6 - 180 + 3;
   LongOriginRad = LongOrigin * RADIANS_PER_DEGREE;
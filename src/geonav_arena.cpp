@@ -0,0 +1,82 @@
+/*
+
+Copyright (c) 2017, Brian Bingham
+All rights reserved
+
+This file is part of the geonav_transform package.
+
+Geonav_transform is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Geonav_transform is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this package.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "geonav_transform/geonav_arena.h"
+
+#include <algorithm>
+
+namespace GeonavTransform
+{
+
+MonotonicArena::MonotonicArena(size_t block_size) :
+  current_(0),
+  offset_(0)
+{
+  Block block;
+  block.size = std::max<size_t>(block_size, 64);
+  block.data.reset(new unsigned char[block.size]);
+  blocks_.push_back(std::move(block));
+}
+
+void MonotonicArena::reset()
+{
+  current_ = 0;
+  offset_ = 0;
+}
+
+size_t MonotonicArena::capacity() const
+{
+  size_t total = 0;
+  for (size_t i = 0; i < blocks_.size(); ++i)
+  {
+    total += blocks_[i].size;
+  }
+  return total;
+}
+
+void *MonotonicArena::allocateBytes(size_t bytes, size_t alignment)
+{
+  while (true)
+  {
+    Block &block = blocks_[current_];
+    size_t base = reinterpret_cast<size_t>(block.data.get());
+    size_t start = (base + offset_ + alignment - 1) / alignment * alignment - base;
+    if (start + bytes <= block.size)
+    {
+      offset_ = start + bytes;
+      return block.data.get() + start;
+    }
+
+    // Move on to the next block kept from an earlier batch, or grow
+    ++current_;
+    offset_ = 0;
+    if (current_ == blocks_.size())
+    {
+      Block grown;
+      grown.size = std::max(blocks_.back().size * 2, bytes + alignment);
+      grown.data.reset(new unsigned char[grown.size]);
+      blocks_.push_back(std::move(grown));
+    }
+  }
+}
+
+}  // namespace GeonavTransform
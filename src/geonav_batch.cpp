@@ -0,0 +1,312 @@
+/*
+
+Copyright (c) 2017, Brian Bingham
+All rights reserved
+
+This file is part of the geonav_transform package.
+
+Geonav_transform is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Geonav_transform is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this package.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "geonav_transform/geonav_batch.h"
+#include "geonav_transform/navsat_conversions.h"
+
+#include <cmath>
+#include <cstdio>
+
+namespace GeonavTransform
+{
+namespace GeonavBatch
+{
+  // Same series as NavsatConversions::LLtoUTM/UTMtoLL (USGS Bulletin 1532),
+  // rearranged so the loop bodies are branch-free and use one sin/cos pair
+  // per point (multiple angles come from the double angle identities).
+  // This lets the compiler vectorize the loops.
+
+  namespace
+  {
+    const double E2 = UTM_E2;
+    const double E4 = UTM_E4;
+    const double E6 = UTM_E6;
+    const double EP2 = UTM_EP2;
+
+    // Meridional arc coefficients
+    const double M0 = WGS84_A*(1 - E2/4 - 3*E4/64 - 5*E6/256);
+    const double M2 = WGS84_A*(3*E2/8 + 3*E4/32 + 45*E6/1024);
+    const double M4 = WGS84_A*(15*E4/256 + 45*E6/1024);
+    const double M6 = WGS84_A*(35*E6/3072);
+
+    double falseNorthing(bool north)
+    {
+      return north ? UTM_FN_N : UTM_FN_S;
+    }
+
+    double centralMeridian(int zone)
+    {
+      // +3 puts origin in middle of zone
+      return ((zone - 1)*6 - 180 + 3) * NavsatConversions::RADIANS_PER_DEGREE;
+    }
+  }  // namespace
+
+  Datum makeDatum(double lat, double lon, double alt)
+  {
+    Datum datum;
+    UTMZones(&lat, &lon, 1, &datum.zone, &datum.band);
+    datum.north = !(lat < 0);
+    datum.altitude = alt;
+    LLtoUTM(&lat, &lon, 1, datum.zone, datum.north,
+            &datum.northing, &datum.easting);
+    return datum;
+  }
+
+  std::string zoneString(const Datum &datum)
+  {
+    char zone_buf[] = {0, 0, 0, 0};
+    snprintf(zone_buf, sizeof(zone_buf), "%d%c", datum.zone, datum.band);
+    return std::string(zone_buf);
+  }
+
+  void UTMZones(const double *lat, const double *lon, size_t count,
+                int *zone, char *band)
+  {
+    for (size_t i = 0; i < count; ++i)
+    {
+      // Make sure the longitude is between -180.00 .. 179.9
+      double lon_norm = (lon[i]+180)-static_cast<int>((lon[i]+180)/360)*360-180;
+      if (zone)
+      {
+        zone[i] = NavsatConversions::UTMZoneNumber(lat[i], lon_norm);
+      }
+      if (band)
+      {
+        band[i] = NavsatConversions::UTMLetterDesignator(lat[i]);
+      }
+    }
+  }
+
+  void LLtoUTM(const double *lat, const double *lon, size_t count,
+               int zone, bool north, double *northing, double *easting)
+  {
+    const double lon0 = centralMeridian(zone);
+    const double fn = falseNorthing(north);
+    const double k0 = UTM_K0;
+
+    for (size_t i = 0; i < count; ++i)
+    {
+      const double phi = lat[i] * NavsatConversions::RADIANS_PER_DEGREE;
+      double dlon = lon[i] * NavsatConversions::RADIANS_PER_DEGREE - lon0;
+      // Wrap the longitude difference so zones 1 and 60 stay adjacent
+      dlon -= 2*M_PI * std::floor((dlon + M_PI) / (2*M_PI));
+
+      const double s = std::sin(phi);
+      const double c = std::cos(phi);
+      const double t = s / c;
+
+      // sin(2phi), sin(4phi), sin(6phi) from the double angle identities
+      const double s2 = 2*s*c;
+      const double c2 = c*c - s*s;
+      const double s4 = 2*s2*c2;
+      const double c4 = c2*c2 - s2*s2;
+      const double s6 = s4*c2 + c4*s2;
+
+      const double N = WGS84_A / std::sqrt(1 - E2*s*s);
+      const double T = t*t;
+      const double C = EP2*c*c;
+      const double A = c*dlon;
+      const double A2 = A*A;
+      const double M = M0*phi - M2*s2 + M4*s4 - M6*s6;
+
+      easting[i] = k0*N*(A + (1-T+C)*A*A2/6
+                         + (5-18*T+T*T+72*C-58*EP2)*A*A2*A2/120)
+        + UTM_FE;
+      northing[i] = k0*(M + N*t*(A2/2 + (5-T+9*C+4*C*C)*A2*A2/24
+                                 + (61-58*T+T*T+600*C-330*EP2)
+                                 *A2*A2*A2/720))
+        + fn;
+    }
+  }
+
+  void UTMtoLL(const double *northing, const double *easting, size_t count,
+               int zone, bool north, double *lat, double *lon)
+  {
+    const double lon0 = centralMeridian(zone);
+    const double fn = falseNorthing(north);
+    const double k0 = UTM_K0;
+    const double e1 = (1-std::sqrt(1-E2))/(1+std::sqrt(1-E2));
+    const double p2 = 3*e1/2 - 27*e1*e1*e1/32;
+    const double p4 = 21*e1*e1/16 - 55*e1*e1*e1*e1/32;
+    const double p6 = 151*e1*e1*e1/96;
+
+    for (size_t i = 0; i < count; ++i)
+    {
+      const double x = easting[i] - UTM_FE;
+      const double mu = (northing[i] - fn) / k0 / M0;
+
+      const double sm = std::sin(mu);
+      const double cm = std::cos(mu);
+      const double sm2 = 2*sm*cm;
+      const double cm2 = cm*cm - sm*sm;
+      const double sm4 = 2*sm2*cm2;
+      const double cm4 = cm2*cm2 - sm2*sm2;
+      const double sm6 = sm4*cm2 + cm4*sm2;
+      const double phi1 = mu + p2*sm2 + p4*sm4 + p6*sm6;
+
+      const double s = std::sin(phi1);
+      const double c = std::cos(phi1);
+      const double t = s / c;
+      const double w = 1 - E2*s*s;
+      const double N1 = WGS84_A / std::sqrt(w);
+      const double T1 = t*t;
+      const double C1 = EP2*c*c;
+      // N1/R1 reduces to w/(1-e^2)
+      const double N1_R1 = w / (1 - E2);
+      const double D = x / (N1*k0);
+      const double D2 = D*D;
+
+      lat[i] = (phi1 - (t*N1_R1)
+                *(D2/2
+                  - (5+3*T1+10*C1-4*C1*C1-9*EP2)*D2*D2/24
+                  + (61+90*T1+298*C1+45*T1*T1-252*EP2-3*C1*C1)*D2*D2*D2/720))
+        * NavsatConversions::DEGREES_PER_RADIAN;
+      lon[i] = (lon0 + (D - (1+2*T1+C1)*D*D2/6
+                        + (5-2*C1+28*T1-3*C1*C1+8*EP2+24*T1*T1)*D*D2*D2/120)
+                / c) * NavsatConversions::DEGREES_PER_RADIAN;
+    }
+  }
+
+  void LLtoLocal(const Datum &datum, const double *lat, const double *lon,
+                 size_t count, double *x, double *y)
+  {
+    LLtoUTM(lat, lon, count, datum.zone, datum.north, y, x);
+    for (size_t i = 0; i < count; ++i)
+    {
+      x[i] -= datum.easting;
+      y[i] -= datum.northing;
+    }
+  }
+
+  void LocalToLL(const Datum &datum, const double *x, const double *y,
+                 size_t count, double *lat, double *lon)
+  {
+    // Shift in place through the outputs to avoid a temporary
+    for (size_t i = 0; i < count; ++i)
+    {
+      lat[i] = y[i] + datum.northing;
+      lon[i] = x[i] + datum.easting;
+    }
+    UTMtoLL(lat, lon, count, datum.zone, datum.north, lat, lon);
+  }
+
+  void UTMtoUTMZone(const double *northing, const double *easting,
+                    size_t count, int from_zone, int to_zone, bool north,
+                    double *to_northing, double *to_easting)
+  {
+    // Through geographic in stack blocks, so it works in place
+    const size_t block = 256;
+    double lat[block];
+    double lon[block];
+    for (size_t b = 0; b < count; b += block)
+    {
+      const size_t n = std::min(block, count - b);
+      UTMtoLL(northing + b, easting + b, n, from_zone, north, lat, lon);
+      LLtoUTM(lat, lon, n, to_zone, north, to_northing + b, to_easting + b);
+    }
+  }
+
+  ZoneTransform zoneTransform(const Datum &datum, int from_zone)
+  {
+    // The datum and points 1 km east and north of it, in the datum's zone
+    // and in from_zone
+    const double step = 1000.0;
+    double to_n[] = {datum.northing, datum.northing, datum.northing + step};
+    double to_e[] = {datum.easting, datum.easting + step, datum.easting};
+    double from_n[3];
+    double from_e[3];
+    UTMtoUTMZone(to_n, to_e, 3, datum.zone, from_zone, datum.north,
+                 from_n, from_e);
+
+    // Rotation taking the from_zone grid axes onto the datum's, averaged
+    // over the east and north axes
+    double yaw_e = std::atan2(from_n[1] - from_n[0], from_e[1] - from_e[0]);
+    double yaw_n = std::atan2(from_e[2] - from_e[0], from_n[2] - from_n[0]);
+    double yaw = -0.5 * (yaw_e - yaw_n);
+
+    ZoneTransform transform;
+    transform.from_zone = from_zone;
+    transform.to_zone = datum.zone;
+    transform.north = datum.north;
+    transform.yaw = yaw;
+    transform.x = datum.easting
+      - (std::cos(yaw) * from_e[0] - std::sin(yaw) * from_n[0]);
+    transform.y = datum.northing
+      - (std::sin(yaw) * from_e[0] + std::cos(yaw) * from_n[0]);
+    return transform;
+  }
+
+  void applyZoneTransform(const ZoneTransform &transform,
+                          const double *northing, const double *easting,
+                          size_t count,
+                          double *to_northing, double *to_easting)
+  {
+    const double c = std::cos(transform.yaw);
+    const double s = std::sin(transform.yaw);
+    for (size_t i = 0; i < count; ++i)
+    {
+      const double e = easting[i];
+      const double n = northing[i];
+      to_easting[i] = c*e - s*n + transform.x;
+      to_northing[i] = s*e + c*n + transform.y;
+    }
+  }
+
+  PointDiagnostics checkPoints(Span<const double> lat, Span<const double> lon,
+                               int zone, MonotonicArena &arena)
+  {
+    PointDiagnostics diag;
+    diag.count = std::min(lat.size, lon.size);
+    diag.flagged = 0;
+    diag.zone = arena.allocate<int>(diag.count);
+    diag.band = arena.allocate<char>(diag.count);
+    diag.flags = arena.allocate<uint8_t>(diag.count);
+
+    for (size_t i = 0; i < diag.count; ++i)
+    {
+      if (!std::isfinite(lat[i]) || !std::isfinite(lon[i]))
+      {
+        diag.zone[i] = 0;
+        diag.band[i] = 'Z';
+        diag.flags[i] = POINT_INVALID;
+        ++diag.flagged;
+        continue;
+      }
+
+      UTMZones(&lat[i], &lon[i], 1, &diag.zone[i], &diag.band[i]);
+      uint8_t flags = POINT_OK;
+      if (diag.band[i] == 'Z')
+      {
+        flags |= POINT_OUTSIDE_UTM;
+      }
+      if (diag.zone[i] != zone)
+      {
+        flags |= POINT_OTHER_ZONE;
+      }
+      diag.flags[i] = flags;
+      diag.flagged += (flags != POINT_OK);
+    }
+    return diag;
+  }
+
+}  // namespace GeonavBatch
+}  // namespace GeonavTransform
@@ -0,0 +1,188 @@
+/*
+
+Copyright (c) 2017, Brian Bingham
+All rights reserved
+
+This file is part of the geonav_transform package.
+
+Geonav_transform is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Geonav_transform is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this package.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "geonav_transform/geonav_batch_async.h"
+
+#include <algorithm>
+
+namespace GeonavTransform
+{
+namespace GeonavBatch
+{
+  namespace
+  {
+    //! @brief Completion state shared by the chunks of one batch
+    struct ChunkedJob
+    {
+      std::atomic<size_t> remaining;
+      std::atomic<size_t> converted;
+      BatchCallback done;
+    };
+
+    //! @brief Wrap a future in a completion callback
+    BatchCallback promiseCallback(std::future<size_t> &future)
+    {
+      std::shared_ptr<std::promise<size_t> > promise =
+        std::make_shared<std::promise<size_t> >();
+      future = promise->get_future();
+      return [promise](size_t converted) { promise->set_value(converted); };
+    }
+  }  // namespace
+
+  void runChunked(size_t count,
+                  const std::function<void(size_t, size_t)> &kernel,
+                  const BatchCallback &done,
+                  const BatchOptions &options)
+  {
+    ThreadPool &pool = options.pool ? *options.pool : ThreadPool::shared();
+    const size_t chunk = std::max<size_t>(options.chunk_size, 1);
+    const size_t chunks = (count + chunk - 1) / chunk;
+    if (chunks == 0)
+    {
+      // Still on a pool thread, as documented, so callers can hold locks
+      // that done takes
+      BatchCallback finish = done;
+      pool.submit([finish]() { finish(0); });
+      return;
+    }
+
+    std::shared_ptr<ChunkedJob> job = std::make_shared<ChunkedJob>();
+    job->remaining = chunks;
+    job->converted = 0;
+    job->done = done;
+    const CancelToken cancel = options.cancel;
+
+    for (size_t c = 0; c < chunks; ++c)
+    {
+      const size_t begin = c * chunk;
+      const size_t end = std::min(count, begin + chunk);
+      pool.submit([job, kernel, cancel, begin, end]()
+      {
+        if (!cancel.cancelled())
+        {
+          kernel(begin, end);
+          job->converted += end - begin;
+        }
+        if (--job->remaining == 0)
+        {
+          job->done(job->converted.load());
+        }
+      });
+    }
+  }
+
+  void LLtoUTMAsync(const double *lat, const double *lon,
+                    size_t count, int zone, bool north,
+                    double *northing, double *easting,
+                    const BatchCallback &done,
+                    const BatchOptions &options)
+  {
+    runChunked(count, [=](size_t b, size_t e)
+    {
+      LLtoUTM(lat + b, lon + b, e - b, zone, north, northing + b, easting + b);
+    }, done, options);
+  }
+
+  std::future<size_t> LLtoUTMAsync(const double *lat, const double *lon,
+                                   size_t count, int zone, bool north,
+                                   double *northing, double *easting,
+                                   const BatchOptions &options)
+  {
+    std::future<size_t> future;
+    BatchCallback done = promiseCallback(future);
+    LLtoUTMAsync(lat, lon, count, zone, north, northing, easting,
+                 done, options);
+    return future;
+  }
+
+  void UTMtoLLAsync(const double *northing, const double *easting,
+                    size_t count, int zone, bool north,
+                    double *lat, double *lon,
+                    const BatchCallback &done,
+                    const BatchOptions &options)
+  {
+    runChunked(count, [=](size_t b, size_t e)
+    {
+      UTMtoLL(northing + b, easting + b, e - b, zone, north, lat + b, lon + b);
+    }, done, options);
+  }
+
+  std::future<size_t> UTMtoLLAsync(const double *northing, const double *easting,
+                                   size_t count, int zone, bool north,
+                                   double *lat, double *lon,
+                                   const BatchOptions &options)
+  {
+    std::future<size_t> future;
+    BatchCallback done = promiseCallback(future);
+    UTMtoLLAsync(northing, easting, count, zone, north, lat, lon,
+                 done, options);
+    return future;
+  }
+
+  void LLtoLocalAsync(const Datum &datum,
+                      const double *lat, const double *lon,
+                      size_t count, double *x, double *y,
+                      const BatchCallback &done,
+                      const BatchOptions &options)
+  {
+    runChunked(count, [=](size_t b, size_t e)
+    {
+      LLtoLocal(datum, lat + b, lon + b, e - b, x + b, y + b);
+    }, done, options);
+  }
+
+  std::future<size_t> LLtoLocalAsync(const Datum &datum,
+                                     const double *lat, const double *lon,
+                                     size_t count, double *x, double *y,
+                                     const BatchOptions &options)
+  {
+    std::future<size_t> future;
+    BatchCallback done = promiseCallback(future);
+    LLtoLocalAsync(datum, lat, lon, count, x, y, done, options);
+    return future;
+  }
+
+  void LocalToLLAsync(const Datum &datum,
+                      const double *x, const double *y,
+                      size_t count, double *lat, double *lon,
+                      const BatchCallback &done,
+                      const BatchOptions &options)
+  {
+    runChunked(count, [=](size_t b, size_t e)
+    {
+      LocalToLL(datum, x + b, y + b, e - b, lat + b, lon + b);
+    }, done, options);
+  }
+
+  std::future<size_t> LocalToLLAsync(const Datum &datum,
+                                     const double *x, const double *y,
+                                     size_t count, double *lat, double *lon,
+                                     const BatchOptions &options)
+  {
+    std::future<size_t> future;
+    BatchCallback done = promiseCallback(future);
+    LocalToLLAsync(datum, x, y, count, lat, lon, done, options);
+    return future;
+  }
+
+}  // namespace GeonavBatch
+}  // namespace GeonavTransform
@@ -0,0 +1,468 @@
+/*
+
+Copyright (c) 2017, Brian Bingham
+All rights reserved
+
+This file is part of the geonav_transform package.
+
+Geonav_transform is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Geonav_transform is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this package.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "geonav_transform/geonav_coverage.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+namespace GeonavTransform
+{
+
+const int CoverageGrid::TILE_SIZE;
+const int CoverageGrid::TILE_CELLS;
+
+namespace
+{
+  const uint16_t SATURATED = std::numeric_limits<uint16_t>::max();
+
+  int floorDiv(int a, int b)
+  {
+    return (a >= 0) ? a / b : -((b - 1 - a) / b);
+  }
+
+  int64_t tileKey(int32_t x, int32_t y)
+  {
+    return (static_cast<int64_t>(x) << 32) | static_cast<uint32_t>(y);
+  }
+
+  const size_t NO_SLOT = std::numeric_limits<size_t>::max();
+
+  void clearEncoded(CoverageGrid::Encoded &out)
+  {
+    out.tile_x.clear();
+    out.tile_y.clear();
+    out.generation.clear();
+    out.run_start.clear();
+    out.run_length.clear();
+    out.run_passes.clear();
+    out.run_soundings.clear();
+  }
+}  // namespace
+
+CoverageGrid::CoverageGrid(double resolution, size_t max_tiles) :
+  resolution_(resolution),
+  max_tiles_(std::max<size_t>(max_tiles, 1)),
+  max_step_(0.0),
+  last_slot_(0),
+  oldest_(NO_SLOT),
+  newest_(NO_SLOT),
+  evicted_(0),
+  has_last_(false),
+  last_x_(0.0),
+  last_y_(0.0),
+  last_width_(0.0)
+{
+  last_left_[0] = last_left_[1] = 0.0;
+  last_right_[0] = last_right_[1] = 0.0;
+}
+
+void CoverageGrid::clear()
+{
+  tiles_.clear();
+  index_.clear();
+  last_slot_ = 0;
+  oldest_ = NO_SLOT;
+  newest_ = NO_SLOT;
+  evicted_ = 0;
+  clearEncoded(pending_);
+  generations_.clear();
+  has_last_ = false;
+}
+
+void CoverageGrid::setMaxStep(double max_step)
+{
+  max_step_ = max_step;
+}
+
+void CoverageGrid::breakTrack()
+{
+  has_last_ = false;
+}
+
+double CoverageGrid::resolution() const
+{
+  return resolution_;
+}
+
+size_t CoverageGrid::tiles() const
+{
+  return tiles_.size();
+}
+
+size_t CoverageGrid::evicted() const
+{
+  return evicted_;
+}
+
+void CoverageGrid::touch(size_t slot)
+{
+  if (slot == newest_)
+  {
+    return;
+  }
+  Tile &tile = *tiles_[slot];
+  // Unlink, unless it's a new slot
+  if (tile.older != NO_SLOT || tile.newer != NO_SLOT || slot == oldest_)
+  {
+    if (tile.older != NO_SLOT)
+    {
+      tiles_[tile.older]->newer = tile.newer;
+    }
+    else
+    {
+      oldest_ = tile.newer;
+    }
+    tiles_[tile.newer]->older = tile.older;
+  }
+  tile.older = newest_;
+  tile.newer = NO_SLOT;
+  if (newest_ != NO_SLOT)
+  {
+    tiles_[newest_]->newer = slot;
+  }
+  else
+  {
+    oldest_ = slot;
+  }
+  newest_ = slot;
+}
+
+CoverageGrid::Tile &CoverageGrid::tileFor(int i, int j)
+{
+  const int32_t tx = floorDiv(i, TILE_SIZE);
+  const int32_t ty = floorDiv(j, TILE_SIZE);
+  if (last_slot_ < tiles_.size())
+  {
+    Tile &last = *tiles_[last_slot_];
+    if (last.x == tx && last.y == ty)
+    {
+      touch(last_slot_);
+      return last;
+    }
+  }
+
+  const int64_t key = tileKey(tx, ty);
+  std::unordered_map<int64_t, size_t>::const_iterator found = index_.find(key);
+  if (found != index_.end())
+  {
+    last_slot_ = found->second;
+    touch(last_slot_);
+    return *tiles_[last_slot_];
+  }
+
+  size_t slot = tiles_.size();
+  if (slot < max_tiles_)
+  {
+    tiles_.push_back(std::unique_ptr<Tile>(new Tile));
+    tiles_[slot]->older = NO_SLOT;
+    tiles_[slot]->newer = NO_SLOT;
+  }
+  else
+  {
+    // Full - recycle the least recently updated tile, keeping its
+    // unpublished changes for the next encode()
+    slot = oldest_;
+    Tile &old = *tiles_[slot];
+    if (old.dirty)
+    {
+      encodeTile(old, pending_);
+    }
+    const int64_t old_key = tileKey(old.x, old.y);
+    index_.erase(old_key);
+    generations_[old_key] = old.generation + 1;
+    ++evicted_;
+  }
+  touch(slot);
+  Tile &tile = *tiles_[slot];
+  tile.x = tx;
+  tile.y = ty;
+  // Covered again after being dropped - restart in its next generation
+  tile.generation = 0;
+  std::unordered_map<int64_t, uint32_t>::iterator dropped = generations_.find(key);
+  if (dropped != generations_.end())
+  {
+    tile.generation = dropped->second;
+    generations_.erase(dropped);
+  }
+  tile.dirty = true;
+  std::memset(tile.passes, 0, sizeof(tile.passes));
+  std::memset(tile.soundings, 0, sizeof(tile.soundings));
+  index_[key] = slot;
+  last_slot_ = slot;
+  return tile;
+}
+
+void CoverageGrid::markSpan(int i0, int i1, int j)
+{
+  while (i0 < i1)
+  {
+    Tile &tile = tileFor(i0, j);
+    const int col = i0 - tile.x * TILE_SIZE;
+    const int n = std::min(i1 - i0, TILE_SIZE - col);
+    uint16_t *passes = tile.passes + (j - tile.y * TILE_SIZE) * TILE_SIZE + col;
+    for (int k = 0; k < n; ++k)
+    {
+      passes[k] += (passes[k] != SATURATED);
+    }
+    tile.dirty = true;
+    i0 += n;
+  }
+}
+
+void CoverageGrid::markTrack(double x0, double y0, double x1, double y1)
+{
+  // Cell traversal (Amanatides & Woo), skipping the start cell
+  int i = static_cast<int>(std::floor(x0 / resolution_));
+  int j = static_cast<int>(std::floor(y0 / resolution_));
+  const int i_end = static_cast<int>(std::floor(x1 / resolution_));
+  const int j_end = static_cast<int>(std::floor(y1 / resolution_));
+  const double dx = x1 - x0;
+  const double dy = y1 - y0;
+  const double inf = std::numeric_limits<double>::infinity();
+  const int step_i = (dx > 0) ? 1 : -1;
+  const int step_j = (dy > 0) ? 1 : -1;
+  double t_max_x = (dx != 0) ? ((i + (dx > 0)) * resolution_ - x0) / dx : inf;
+  double t_max_y = (dy != 0) ? ((j + (dy > 0)) * resolution_ - y0) / dy : inf;
+  const double t_delta_x = (dx != 0) ? resolution_ / std::fabs(dx) : inf;
+  const double t_delta_y = (dy != 0) ? resolution_ / std::fabs(dy) : inf;
+
+  // Bounded by the cell distance, in case rounding misses the end cell
+  int steps = std::abs(i_end - i) + std::abs(j_end - j);
+  for (; steps > 0; --steps)
+  {
+    if (t_max_x < t_max_y)
+    {
+      i += step_i;
+      t_max_x += t_delta_x;
+    }
+    else
+    {
+      j += step_j;
+      t_max_y += t_delta_y;
+    }
+    markSpan(i, i + 1, j);
+  }
+}
+
+void CoverageGrid::fillQuad(const double *qx, const double *qy)
+{
+  // Scanline fill on the cell centres.  Crossings are half-open in y and
+  // spans half-open in x, and each edge is evaluated from its lower end,
+  // so quads sharing an edge cover every cell exactly once.
+  const double min_y = std::min(std::min(qy[0], qy[1]), std::min(qy[2], qy[3]));
+  const double max_y = std::max(std::max(qy[0], qy[1]), std::max(qy[2], qy[3]));
+  const int j0 = static_cast<int>(std::ceil(min_y / resolution_ - 0.5));
+  const int j1 = static_cast<int>(std::ceil(max_y / resolution_ - 0.5));
+  for (int j = j0; j < j1; ++j)
+  {
+    const double cy = (j + 0.5) * resolution_;
+    double xs[4];
+    int n = 0;
+    for (int e = 0; e < 4; ++e)
+    {
+      int a = e;
+      int b = (e + 1) % 4;
+      if ((qy[a] <= cy) == (qy[b] <= cy))
+      {
+        continue;
+      }
+      if (qy[b] < qy[a] || (qy[b] == qy[a] && qx[b] < qx[a]))
+      {
+        std::swap(a, b);
+      }
+      xs[n++] = qx[a] + (cy - qy[a]) * (qx[b] - qx[a]) / (qy[b] - qy[a]);
+    }
+    // At most four crossings - insertion sort
+    for (int k = 1; k < n; ++k)
+    {
+      for (int m = k; m > 0 && xs[m] < xs[m - 1]; --m)
+      {
+        std::swap(xs[m], xs[m - 1]);
+      }
+    }
+    for (int k = 0; k + 1 < n; k += 2)
+    {
+      const int i0 = static_cast<int>(std::ceil(xs[k] / resolution_ - 0.5));
+      const int i1 = static_cast<int>(std::ceil(xs[k + 1] / resolution_ - 0.5));
+      markSpan(i0, i1, j);
+    }
+  }
+}
+
+void CoverageGrid::addPose(double x, double y, double yaw, double swath_width)
+{
+  if (!std::isfinite(x) || !std::isfinite(y) || !std::isfinite(yaw))
+  {
+    return;
+  }
+  const double width = (swath_width > 0.0) ? swath_width : 0.0;
+  // Swath ends, to port and starboard
+  const double half_x = -std::sin(yaw) * 0.5 * width;
+  const double half_y = std::cos(yaw) * 0.5 * width;
+  const double left[2] = {x + half_x, y + half_y};
+  const double right[2] = {x - half_x, y - half_y};
+
+  if (has_last_ && max_step_ > 0.0 &&
+      std::hypot(x - last_x_, y - last_y_) > max_step_)
+  {
+    has_last_ = false;
+  }
+  if (!has_last_)
+  {
+    if (width == 0.0)
+    {
+      const int i = static_cast<int>(std::floor(x / resolution_));
+      markSpan(i, i + 1, static_cast<int>(std::floor(y / resolution_)));
+    }
+  }
+  else if (width > 0.0 && last_width_ > 0.0)
+  {
+    // Area swept since the last pose
+    const double qx[4] = {last_left_[0], last_right_[0], right[0], left[0]};
+    const double qy[4] = {last_left_[1], last_right_[1], right[1], left[1]};
+    fillQuad(qx, qy);
+  }
+  else
+  {
+    markTrack(last_x_, last_y_, x, y);
+  }
+
+  has_last_ = true;
+  last_x_ = x;
+  last_y_ = y;
+  last_width_ = width;
+  last_left_[0] = left[0];
+  last_left_[1] = left[1];
+  last_right_[0] = right[0];
+  last_right_[1] = right[1];
+}
+
+void CoverageGrid::addSoundings(const double *x, const double *y, size_t count)
+{
+  for (size_t k = 0; k < count; ++k)
+  {
+    if (!std::isfinite(x[k]) || !std::isfinite(y[k]))
+    {
+      continue;
+    }
+    const int i = static_cast<int>(std::floor(x[k] / resolution_));
+    const int j = static_cast<int>(std::floor(y[k] / resolution_));
+    Tile &tile = tileFor(i, j);
+    uint16_t &soundings = tile.soundings[(j - tile.y * TILE_SIZE) * TILE_SIZE
+                                         + (i - tile.x * TILE_SIZE)];
+    soundings += (soundings != SATURATED);
+    tile.dirty = true;
+  }
+}
+
+bool CoverageGrid::cell(double x, double y,
+                        uint16_t &passes, uint16_t &soundings) const
+{
+  const int i = static_cast<int>(std::floor(x / resolution_));
+  const int j = static_cast<int>(std::floor(y / resolution_));
+  const int32_t tx = floorDiv(i, TILE_SIZE);
+  const int32_t ty = floorDiv(j, TILE_SIZE);
+  std::unordered_map<int64_t, size_t>::const_iterator found =
+    index_.find(tileKey(tx, ty));
+  if (found == index_.end())
+  {
+    return false;
+  }
+  const Tile &tile = *tiles_[found->second];
+  const int k = (j - ty * TILE_SIZE) * TILE_SIZE + (i - tx * TILE_SIZE);
+  passes = tile.passes[k];
+  soundings = tile.soundings[k];
+  return true;
+}
+
+void CoverageGrid::encodeTile(const Tile &tile, Encoded &out)
+{
+  out.tile_x.push_back(tile.x);
+  out.tile_y.push_back(tile.y);
+  out.generation.push_back(tile.generation);
+  out.run_start.push_back(out.run_length.size());
+  int k = 0;
+  while (k < TILE_CELLS)
+  {
+    const uint16_t passes = tile.passes[k];
+    const uint16_t soundings = tile.soundings[k];
+    int n = 1;
+    while (k + n < TILE_CELLS && tile.passes[k + n] == passes &&
+           tile.soundings[k + n] == soundings)
+    {
+      ++n;
+    }
+    out.run_length.push_back(n);
+    out.run_passes.push_back(passes);
+    out.run_soundings.push_back(soundings);
+    k += n;
+  }
+}
+
+size_t CoverageGrid::encode(bool changed_only, Encoded &out)
+{
+  // Dropped tiles first, so their entries are replaced if they came back;
+  // swapping hands pending_ the old buffers of out to reuse
+  std::swap(out, pending_);
+  clearEncoded(pending_);
+  for (size_t slot = 0; slot < tiles_.size(); ++slot)
+  {
+    Tile &tile = *tiles_[slot];
+    if (changed_only && !tile.dirty)
+    {
+      continue;
+    }
+    encodeTile(tile, out);
+    tile.dirty = false;
+  }
+  return out.tile_x.size();
+}
+
+bool CoverageGrid::decode(const Encoded &in, size_t t,
+                          uint16_t *passes, uint16_t *soundings)
+{
+  if (t >= in.run_start.size())
+  {
+    return false;
+  }
+  const size_t begin = in.run_start[t];
+  const size_t end = (t + 1 < in.run_start.size()) ? in.run_start[t + 1]
+    : in.run_length.size();
+  size_t k = 0;
+  for (size_t r = begin; r < end && r < in.run_length.size(); ++r)
+  {
+    const size_t n = in.run_length[r];
+    if (k + n > static_cast<size_t>(TILE_CELLS))
+    {
+      return false;
+    }
+    std::fill(passes + k, passes + k + n, in.run_passes[r]);
+    std::fill(soundings + k, soundings + k + n, in.run_soundings[r]);
+    k += n;
+  }
+  return k == static_cast<size_t>(TILE_CELLS);
+}
+
+}  // namespace GeonavTransform
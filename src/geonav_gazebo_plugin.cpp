@@ -0,0 +1,206 @@
+/*
+
+Copyright (c) 2017, Brian Bingham
+All rights reserved
+
+This file is part of the geonav_transform package.
+
+Geonav_transform is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Geonav_transform is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this package.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "geonav_transform/geonav_gazebo_plugin.h"
+
+#include <ignition/math/Pose3.hh>
+#include <ignition/math/Vector3.hh>
+
+namespace GeonavTransform
+{
+
+namespace
+{
+  template <typename T>
+  T sdfParam(const sdf::ElementPtr &sdf, const std::string &name,
+             const T &default_value)
+  {
+    return sdf->HasElement(name) ? sdf->Get<T>(name) : default_value;
+  }
+}  // namespace
+
+GeonavGazeboPlugin::GeonavGazeboPlugin() :
+  origin_x_(0.0),
+  origin_y_(0.0),
+  origin_z_(0.0),
+  update_rate_(0.0)
+{
+}
+
+GeonavGazeboPlugin::~GeonavGazeboPlugin()
+{
+  update_connection_.reset();
+  if (nh_)
+  {
+    nh_->shutdown();
+  }
+}
+
+void GeonavGazeboPlugin::Load(gazebo::physics::ModelPtr model,
+                              sdf::ElementPtr sdf)
+{
+  model_ = model;
+  if (!ros::isInitialized())
+  {
+    ROS_FATAL_STREAM("GeonavGazeboPlugin: ROS isn't initialized, load "
+                     "Gazebo through gazebo_ros (e.g., gzserver -s "
+                     "libgazebo_ros_api_plugin.so)");
+    return;
+  }
+
+  if (!sdf->HasElement("datum"))
+  {
+    ROS_FATAL_STREAM("GeonavGazeboPlugin: <datum> (lat lon alt) is required "
+                     "for model " << model_->GetName());
+    return;
+  }
+  // Latitude, longitude [dec. degrees], altitude [m]
+  const ignition::math::Vector3d datum = sdf->Get<ignition::math::Vector3d>("datum");
+  const ignition::math::Vector3d origin =
+    sdfParam(sdf, "gazebo_origin", datum);
+  datum_ = GeonavBatch::makeDatum(datum.X(), datum.Y(), datum.Z());
+  // Projected once; every update is then a translation
+  const double origin_lat = origin.X();
+  const double origin_lon = origin.Y();
+  GeonavBatch::LLtoLocal(datum_, &origin_lat, &origin_lon, 1,
+                         &origin_x_, &origin_y_);
+  origin_z_ = origin.Z() - datum_.altitude;
+  update_rate_ = sdfParam(sdf, "update_rate", 0.0);
+
+  std::string link_name = sdfParam<std::string>(sdf, "link_name", "");
+  if (!link_name.empty())
+  {
+    link_ = model_->GetLink(link_name);
+    if (!link_)
+    {
+      ROS_FATAL_STREAM("GeonavGazeboPlugin: no link <" << link_name
+                       << "> in model " << model_->GetName());
+      return;
+    }
+  }
+
+  const std::string odom_frame_id =
+    sdfParam<std::string>(sdf, "odom_frame_id", "odom");
+  const std::string utm_frame_id =
+    sdfParam<std::string>(sdf, "utm_frame_id", "utm");
+  const std::string base_link_frame_id =
+    sdfParam<std::string>(sdf, "base_link_frame_id", "base_link");
+  nav_in_odom_.header.frame_id = odom_frame_id;
+  nav_in_odom_.child_frame_id = base_link_frame_id;
+  nav_in_utm_.header.frame_id = utm_frame_id;
+  nav_in_utm_.child_frame_id = base_link_frame_id;
+  nav_in_geo_.child_frame_id = base_link_frame_id;
+
+  // One namespace per vehicle, the model name by default
+  nh_.reset(new ros::NodeHandle(
+    sdfParam<std::string>(sdf, "robot_namespace", model_->GetName())));
+  odom_pub_ = nh_->advertise<nav_msgs::Odometry>("geonav_odom", 10);
+  utm_pub_ = nh_->advertise<nav_msgs::Odometry>("geonav_utm", 10);
+  geo_pub_ = nh_->advertise<nav_msgs::Odometry>("geonav_geo", 10);
+
+  ROS_INFO_STREAM("GeonavGazeboPlugin: model " << model_->GetName()
+                  << " in UTM zone " << GeonavBatch::zoneString(datum_)
+                  << ", Gazebo origin at (" << origin_x_ << ", "
+                  << origin_y_ << ") in " << odom_frame_id);
+
+  update_connection_ = gazebo::event::Events::ConnectWorldUpdateBegin(
+    std::bind(&GeonavGazeboPlugin::onUpdate, this, std::placeholders::_1));
+}
+
+void GeonavGazeboPlugin::onUpdate(const gazebo::common::UpdateInfo &info)
+{
+  if (!limiter_.due(info.simTime.Double(), update_rate_))
+  {
+    return;
+  }
+  const bool odom = (odom_pub_.getNumSubscribers() > 0);
+  const bool utm = (utm_pub_.getNumSubscribers() > 0);
+  const bool geo = (geo_pub_.getNumSubscribers() > 0);
+  if (!odom && !utm && !geo)
+  {
+    return;
+  }
+
+  const ignition::math::Pose3d pose =
+    link_ ? link_->WorldPose() : model_->WorldPose();
+  // Velocities in the body (base_link) frame, as in the nav odometry
+  const ignition::math::Vector3d linear =
+    link_ ? link_->RelativeLinearVel() : model_->RelativeLinearVel();
+  const ignition::math::Vector3d angular =
+    link_ ? link_->RelativeAngularVel() : model_->RelativeAngularVel();
+  const ros::Time stamp(info.simTime.sec, info.simTime.nsec);
+
+  double x = pose.Pos().X() + origin_x_;
+  double y = pose.Pos().Y() + origin_y_;
+  double z = pose.Pos().Z() + origin_z_;
+
+  // Orientation and twist are the same in every output
+  nav_in_odom_.header.stamp = stamp;
+  nav_in_odom_.pose.pose.orientation.x = pose.Rot().X();
+  nav_in_odom_.pose.pose.orientation.y = pose.Rot().Y();
+  nav_in_odom_.pose.pose.orientation.z = pose.Rot().Z();
+  nav_in_odom_.pose.pose.orientation.w = pose.Rot().W();
+  nav_in_odom_.twist.twist.linear.x = linear.X();
+  nav_in_odom_.twist.twist.linear.y = linear.Y();
+  nav_in_odom_.twist.twist.linear.z = linear.Z();
+  nav_in_odom_.twist.twist.angular.x = angular.X();
+  nav_in_odom_.twist.twist.angular.y = angular.Y();
+  nav_in_odom_.twist.twist.angular.z = angular.Z();
+  nav_in_odom_.pose.pose.position.x = x;
+  nav_in_odom_.pose.pose.position.y = y;
+  nav_in_odom_.pose.pose.position.z = z;
+  if (odom)
+  {
+    nav_in_odom_.header.seq++;
+    odom_pub_.publish(nav_in_odom_);
+  }
+  if (utm)
+  {
+    nav_in_utm_.header.stamp = stamp;
+    nav_in_utm_.header.seq++;
+    nav_in_utm_.pose.pose.position.x = x + datum_.easting;
+    nav_in_utm_.pose.pose.position.y = y + datum_.northing;
+    nav_in_utm_.pose.pose.position.z = z + datum_.altitude;
+    nav_in_utm_.pose.pose.orientation = nav_in_odom_.pose.pose.orientation;
+    nav_in_utm_.twist.twist = nav_in_odom_.twist.twist;
+    utm_pub_.publish(nav_in_utm_);
+  }
+  if (geo)
+  {
+    double lat;
+    double lon;
+    GeonavBatch::LocalToLL(datum_, &x, &y, 1, &lat, &lon);
+    // Organized like the nav odometry (x = longitude, y = latitude)
+    nav_in_geo_.header.stamp = stamp;
+    nav_in_geo_.header.seq++;
+    nav_in_geo_.pose.pose.position.x = lon;
+    nav_in_geo_.pose.pose.position.y = lat;
+    nav_in_geo_.pose.pose.position.z = z + datum_.altitude;
+    nav_in_geo_.pose.pose.orientation = nav_in_odom_.pose.pose.orientation;
+    nav_in_geo_.twist.twist = nav_in_odom_.twist.twist;
+    geo_pub_.publish(nav_in_geo_);
+  }
+}
+
+GZ_REGISTER_MODEL_PLUGIN(GeonavGazeboPlugin)
+
+}  // namespace GeonavTransform
@@ -0,0 +1,1281 @@
+/*
+
+Copyright (c) 2017, Brian Bingham
+All rights reserved
+
+This file is part of the geonav_transform package.
+
+Geonav_transform is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Geonav_transform is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this package.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "geonav_transform/geonav_geodesic.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <memory>
+
+namespace GeonavTransform
+{
+namespace GeonavGeodesic
+{
+  // Follows GeographicLib's Geodesic and GeodesicLine classes, specialized
+  // to WGS84 (so the f < 0 branches are dropped) and to the distance and
+  // azimuth outputs (no area, no geodesic scale).
+
+  namespace
+  {
+    const int ORDER = 6;
+    const int NC3X = (ORDER * (ORDER - 1)) / 2;
+
+    const double A = 6378137.0;
+    const double F = 1 / 298.257223563;
+    const double F1 = 1 - F;
+    const double E2 = F * (2 - F);
+    const double EP2 = E2 / (F1 * F1);
+    const double N = F / (2 - F);
+    const double B = A * F1;
+
+    const double DEG = M_PI / 180;
+    const double EPS = std::numeric_limits<double>::epsilon();
+    const double TINY = 1.4916681462400413e-154;  // sqrt(DBL_MIN)
+    const double TOL0 = EPS;
+    const double TOL1 = 200 * TOL0;
+    const double TOL2 = 1.4901161193847656e-08;  // sqrt(EPS)
+    const double TOLB = TOL0;
+    const double XTHRESH = 1000 * TOL2;
+    const int MAXIT1 = 20;
+    const int MAXIT2 = MAXIT1 + std::numeric_limits<double>::digits + 10;
+    //! @brief sig12 threshold for "really short" lines
+    const double ETOL2 = 0.1 * TOL2 / std::sqrt(F * (1 - F / 2) / 2);
+
+    double sq(double x)
+    {
+      return x * x;
+    }
+
+    void norm(double &x, double &y)
+    {
+      double r = std::hypot(x, y);
+      x /= r;
+      y /= r;
+    }
+
+    double polyval(int n, const double *p, double x)
+    {
+      double y = n < 0 ? 0 : *p++;
+      while (--n >= 0)
+      {
+        y = y * x + *p++;
+      }
+      return y;
+    }
+
+    //! @brief Error free sum, u + v = s + t exactly
+    double sum(double u, double v, double &t)
+    {
+      double s = u + v;
+      double up = s - v;
+      double vpp = s - up;
+      up -= u;
+      vpp -= v;
+      t = s != 0 ? 0 - (up + vpp) : s;
+      return s;
+    }
+
+    //! @brief Round tiny angles so they underflow to zero
+    double angRound(double x)
+    {
+      const double z = 1 / 16.0;
+      volatile double y = std::fabs(x);
+      // The compiler mustn't "simplify" z - (z - y) to y
+      if (y < z)
+      {
+        y = z - y;
+        y = z - y;
+      }
+      return std::copysign(static_cast<double>(y), x);
+    }
+
+    double angNormalize(double x)
+    {
+      double y = std::remainder(x, 360.0);
+      return std::fabs(y) == 180 ? std::copysign(180.0, x) : y;
+    }
+
+    double latFix(double x)
+    {
+      return std::fabs(x) > 90 ? std::numeric_limits<double>::quiet_NaN() : x;
+    }
+
+    //! @brief sin and cos of x in degrees, exact at multiples of 90
+    void sincosd(double x, double &sinx, double &cosx)
+    {
+      int q = 0;
+      double r = std::remquo(x, 90.0, &q) * DEG;
+      double s = std::sin(r);
+      double c = std::cos(r);
+      switch (static_cast<unsigned>(q) & 3U)
+      {
+        case 0U: sinx = s; cosx = c; break;
+        case 1U: sinx = c; cosx = -s; break;
+        case 2U: sinx = -s; cosx = -c; break;
+        default: sinx = -c; cosx = s; break;
+      }
+      cosx += 0.0;
+      if (sinx == 0)
+      {
+        sinx = std::copysign(sinx, x);
+      }
+    }
+
+    //! @brief sin and cos of x + t in degrees, x in [-180, 180]
+    void sincosde(double x, double t, double &sinx, double &cosx)
+    {
+      int q = 0;
+      double r = angRound(std::remquo(x, 90.0, &q) + t) * DEG;
+      double s = std::sin(r);
+      double c = std::cos(r);
+      switch (static_cast<unsigned>(q) & 3U)
+      {
+        case 0U: sinx = s; cosx = c; break;
+        case 1U: sinx = c; cosx = -s; break;
+        case 2U: sinx = -s; cosx = -c; break;
+        default: sinx = -c; cosx = s; break;
+      }
+      cosx += 0.0;
+      if (sinx == 0)
+      {
+        sinx = std::copysign(sinx, x);
+      }
+    }
+
+    //! @brief atan2(y, x) in degrees, exact at multiples of 45
+    double atan2d(double y, double x)
+    {
+      int q = 0;
+      if (std::fabs(y) > std::fabs(x))
+      {
+        std::swap(x, y);
+        q = 2;
+      }
+      if (std::signbit(x))
+      {
+        x = -x;
+        ++q;
+      }
+      double ang = std::atan2(y, x) / DEG;
+      switch (q)
+      {
+        case 1: ang = std::copysign(180.0, y) - ang; break;
+        case 2: ang = 90 - ang; break;
+        case 3: ang = -90 + ang; break;
+        default: break;
+      }
+      return ang;
+    }
+
+    //! @brief sum(c[l] * sin(2*l*x), l, 1, n) by Clenshaw summation
+    double sinSeries(double sinx, double cosx, const double *c, int n)
+    {
+      c += n + 1;
+      double ar = 2 * (cosx - sinx) * (cosx + sinx);
+      double y0 = (n & 1) ? *--c : 0;
+      double y1 = 0;
+      n /= 2;
+      while (n--)
+      {
+        y1 = ar * y0 - y1 + *--c;
+        y0 = ar * y1 - y0 + *--c;
+      }
+      return 2 * sinx * cosx * y0;
+    }
+
+    //! @brief Positive root of k^4+2k^3-(x^2+y^2-1)k^2-2y^2k-y^2 = 0
+    double astroid(double x, double y)
+    {
+      double p = sq(x);
+      double q = sq(y);
+      double r = (p + q - 1) / 6;
+      if (q == 0 && r <= 0)
+      {
+        return 0;
+      }
+      double S = p * q / 4;
+      double r2 = sq(r);
+      double r3 = r * r2;
+      double disc = S * (S + 2 * r3);
+      double u = r;
+      if (disc >= 0)
+      {
+        double T3 = S + r3;
+        T3 += T3 < 0 ? -std::sqrt(disc) : std::sqrt(disc);
+        double T = std::cbrt(T3);
+        u += T + (T != 0 ? r2 / T : 0);
+      }
+      else
+      {
+        double ang = std::atan2(std::sqrt(-disc), -(S + r3));
+        u += 2 * r * std::cos(ang / 3);
+      }
+      double v = std::sqrt(sq(u) + q);
+      double uv = u < 0 ? q / (v - u) : u + v;
+      double w = (uv - q) / (2 * v);
+      return uv / (std::sqrt(uv + sq(w)) + w);
+    }
+
+    double A1m1f(double eps)
+    {
+      static const double coeff[] = {1, 4, 64, 0, 256};
+      double t = polyval(ORDER / 2, coeff, sq(eps)) / coeff[ORDER / 2 + 1];
+      return (t + eps) / (1 - eps);
+    }
+
+    double A2m1f(double eps)
+    {
+      static const double coeff[] = {-11, -28, -192, 0, 256};
+      double t = polyval(ORDER / 2, coeff, sq(eps)) / coeff[ORDER / 2 + 1];
+      return (t - eps) / (1 + eps);
+    }
+
+    //! @brief c[1..ORDER] from a table of polynomials in eps^2
+    void seriesCoefficients(const double *coeff, double eps, double *c)
+    {
+      double eps2 = sq(eps);
+      double d = eps;
+      for (int l = 1, o = 0; l <= ORDER; ++l)
+      {
+        int m = (ORDER - l) / 2;
+        c[l] = d * polyval(m, coeff + o, eps2) / coeff[o + m + 1];
+        o += m + 2;
+        d *= eps;
+      }
+    }
+
+    void C1f(double eps, double *c)
+    {
+      static const double coeff[] = {
+        -1, 6, -16, 32,
+        -9, 64, -128, 2048,
+        9, -16, 768,
+        3, -5, 512,
+        -7, 1280,
+        -7, 2048,
+      };
+      seriesCoefficients(coeff, eps, c);
+    }
+
+    void C1pf(double eps, double *c)
+    {
+      static const double coeff[] = {
+        205, -432, 768, 1536,
+        4005, -4736, 3840, 12288,
+        -225, 116, 384,
+        -7173, 2695, 7680,
+        3467, 7680,
+        38081, 61440,
+      };
+      seriesCoefficients(coeff, eps, c);
+    }
+
+    void C2f(double eps, double *c)
+    {
+      static const double coeff[] = {
+        1, 2, 16, 32,
+        35, 64, 384, 2048,
+        15, 80, 768,
+        7, 35, 512,
+        63, 1280,
+        77, 2048,
+      };
+      seriesCoefficients(coeff, eps, c);
+    }
+
+    //! @brief A3 and C3 coefficients, polynomials in eps for WGS84's n
+    struct Coefficients
+    {
+      Coefficients()
+      {
+        static const double A3coeff[] = {
+          -3, 128,
+          -2, -3, 64,
+          -1, -3, -1, 16,
+          3, -1, -2, 8,
+          1, -1, 2,
+          1, 1,
+        };
+        static const double C3coeff[] = {
+          3, 128,
+          2, 5, 128,
+          -1, 3, 3, 64,
+          -1, 0, 1, 8,
+          -1, 1, 4,
+          5, 256,
+          1, 3, 128,
+          -3, -2, 3, 64,
+          1, -3, 2, 32,
+          7, 512,
+          -10, 9, 384,
+          5, -9, 5, 192,
+          7, 512,
+          -14, 7, 512,
+          21, 2560,
+        };
+        for (int j = ORDER - 1, k = 0, o = 0; j >= 0; --j)
+        {
+          int m = std::min(ORDER - j - 1, j);
+          A3x[k++] = polyval(m, A3coeff + o, N) / A3coeff[o + m + 1];
+          o += m + 2;
+        }
+        for (int l = 1, k = 0, o = 0; l < ORDER; ++l)
+        {
+          for (int j = ORDER - 1; j >= l; --j)
+          {
+            int m = std::min(ORDER - j - 1, j);
+            C3x[k++] = polyval(m, C3coeff + o, N) / C3coeff[o + m + 1];
+            o += m + 2;
+          }
+        }
+      }
+
+      double A3x[ORDER];
+      double C3x[NC3X];
+    };
+
+    const Coefficients &coefficients()
+    {
+      static const Coefficients coefficients;
+      return coefficients;
+    }
+
+    double A3f(double eps)
+    {
+      return polyval(ORDER - 1, coefficients().A3x, eps);
+    }
+
+    //! @brief c[1..ORDER-1]
+    void C3f(double eps, double *c)
+    {
+      const double *C3x = coefficients().C3x;
+      double mult = 1;
+      for (int l = 1, o = 0; l < ORDER; ++l)
+      {
+        int m = ORDER - l - 1;
+        mult *= eps;
+        c[l] = mult * polyval(m, C3x + o, eps);
+        o += m + 1;
+      }
+    }
+
+    double epsilon(double k2)
+    {
+      return k2 / (2 * (1 + std::sqrt(1 + k2)) + k2);
+    }
+
+    //! @brief Distance s12/b and reduced length m12/b of a geodesic segment
+    void lengths(double eps, double sig12,
+                 double ssig1, double csig1, double dn1,
+                 double ssig2, double csig2, double dn2,
+                 bool want_distance, bool want_reduced,
+                 double &s12b, double &m12b)
+    {
+      double C1a[ORDER + 1];
+      double C2a[ORDER + 1];
+      double A1 = A1m1f(eps);
+      C1f(eps, C1a);
+      double A2 = 0;
+      double m0 = 0;
+      if (want_reduced)
+      {
+        A2 = A2m1f(eps);
+        C2f(eps, C2a);
+        m0 = A1 - A2;
+        A2 = 1 + A2;
+      }
+      A1 = 1 + A1;
+      double J12 = 0;
+      if (want_distance)
+      {
+        double B1 = sinSeries(ssig2, csig2, C1a, ORDER) -
+          sinSeries(ssig1, csig1, C1a, ORDER);
+        s12b = A1 * (sig12 + B1);
+        if (want_reduced)
+        {
+          double B2 = sinSeries(ssig2, csig2, C2a, ORDER) -
+            sinSeries(ssig1, csig1, C2a, ORDER);
+          J12 = m0 * sig12 + (A1 * B1 - A2 * B2);
+        }
+      }
+      else if (want_reduced)
+      {
+        for (int l = 1; l <= ORDER; ++l)
+        {
+          C2a[l] = A1 * C1a[l] - A2 * C2a[l];
+        }
+        J12 = m0 * sig12 + (sinSeries(ssig2, csig2, C2a, ORDER) -
+                            sinSeries(ssig1, csig1, C2a, ORDER));
+      }
+      if (want_reduced)
+      {
+        // Parens keep the cancellation accurate for coincident points
+        m12b = dn2 * (csig1 * ssig2) - dn1 * (ssig1 * csig2) -
+          csig1 * csig2 * J12;
+      }
+    }
+
+    //! @brief Starting point for Newton's method
+    //! @return sig12 if the line is short enough to be solved directly
+    //! (salp2, calp2 and dnm are then set too), otherwise -1
+    double inverseStart(double sbet1, double cbet1,
+                        double sbet2, double cbet2,
+                        double lam12, double slam12, double clam12,
+                        double &salp1, double &calp1,
+                        double &salp2, double &calp2, double &dnm)
+    {
+      double sig12 = -1;
+      double sbet12 = sbet2 * cbet1 - cbet2 * sbet1;
+      double cbet12 = cbet2 * cbet1 + sbet2 * sbet1;
+      double sbet12a = sbet2 * cbet1;
+      sbet12a += cbet2 * sbet1;
+
+      bool shortline = cbet12 >= 0 && sbet12 < 0.5 && cbet2 * lam12 < 0.5;
+      double somg12;
+      double comg12;
+      if (shortline)
+      {
+        double sbetm2 = sq(sbet1 + sbet2);
+        sbetm2 /= sbetm2 + sq(cbet1 + cbet2);
+        dnm = std::sqrt(1 + EP2 * sbetm2);
+        double omg12 = lam12 / (F1 * dnm);
+        somg12 = std::sin(omg12);
+        comg12 = std::cos(omg12);
+      }
+      else
+      {
+        somg12 = slam12;
+        comg12 = clam12;
+      }
+
+      salp1 = cbet2 * somg12;
+      calp1 = comg12 >= 0 ?
+        sbet12 + cbet2 * sbet1 * sq(somg12) / (1 + comg12) :
+        sbet12a - cbet2 * sbet1 * sq(somg12) / (1 - comg12);
+
+      double ssig12 = std::hypot(salp1, calp1);
+      double csig12 = sbet1 * sbet2 + cbet1 * cbet2 * comg12;
+
+      if (shortline && ssig12 < ETOL2)
+      {
+        // Really short lines
+        salp2 = cbet1 * somg12;
+        calp2 = sbet12 - cbet1 * sbet2 *
+          (comg12 >= 0 ? sq(somg12) / (1 + comg12) : 1 - comg12);
+        norm(salp2, calp2);
+        sig12 = std::atan2(ssig12, csig12);
+      }
+      else if (csig12 >= 0 || ssig12 >= 6 * N * M_PI * sq(cbet1))
+      {
+        // Zeroth order spherical approximation is OK
+      }
+      else
+      {
+        // Nearly antipodal.  Scale to coordinates where the antipode is at
+        // the origin and the singular point at y = 0, x = -1.
+        double lam12x = std::atan2(-slam12, -clam12);
+        double eps = epsilon(sq(sbet1) * EP2);
+        double lamscale = F * cbet1 * A3f(eps) * M_PI;
+        double betscale = lamscale * cbet1;
+        double x = lam12x / lamscale;
+        double y = sbet12a / betscale;
+
+        if (y > -TOL1 && x > -1 - XTHRESH)
+        {
+          // Strip near the cut
+          salp1 = std::min(1.0, -x);
+          calp1 = -std::sqrt(1 - sq(salp1));
+        }
+        else
+        {
+          // Estimate omg12 from the astroid problem, then alp1 from the
+          // spherical formula
+          double k = astroid(x, y);
+          double omg12a = lamscale * (-x * k / (1 + k));
+          somg12 = std::sin(omg12a);
+          comg12 = -std::cos(omg12a);
+          salp1 = cbet2 * somg12;
+          calp1 = sbet12a - cbet2 * sbet1 * sq(somg12) / (1 - comg12);
+        }
+      }
+      // Backwards check lets NaN through
+      if (!(salp1 <= 0))
+      {
+        norm(salp1, calp1);
+      }
+      else
+      {
+        salp1 = 1;
+        calp1 = 0;
+      }
+      return sig12;
+    }
+
+    //! @brief Longitude difference lam12 for a trial azimuth alp1
+    double lambda12(double sbet1, double cbet1, double dn1,
+                    double sbet2, double cbet2, double dn2,
+                    double salp1, double calp1,
+                    double slam120, double clam120, bool diffp,
+                    double &salp2, double &calp2, double &sig12,
+                    double &ssig1, double &csig1,
+                    double &ssig2, double &csig2,
+                    double &eps, double &dlam12)
+    {
+      if (sbet1 == 0 && calp1 == 0)
+      {
+        // Break the degeneracy of the equatorial line
+        calp1 = -TINY;
+      }
+
+      double salp0 = salp1 * cbet1;
+      double calp0 = std::hypot(calp1, salp1 * sbet1);
+
+      ssig1 = sbet1;
+      double somg1 = salp0 * sbet1;
+      csig1 = calp1 * cbet1;
+      double comg1 = csig1;
+      norm(ssig1, csig1);
+
+      // Enforce the symmetries of |bet2| = -bet1
+      salp2 = cbet2 != cbet1 ? salp0 / cbet2 : salp1;
+      calp2 = cbet2 != cbet1 || std::fabs(sbet2) != -sbet1 ?
+        std::sqrt(sq(calp1 * cbet1) +
+                  (cbet1 < -sbet1 ?
+                   (cbet2 - cbet1) * (cbet1 + cbet2) :
+                   (sbet1 - sbet2) * (sbet1 + sbet2))) / cbet2 :
+        std::fabs(calp1);
+
+      ssig2 = sbet2;
+      double somg2 = salp0 * sbet2;
+      csig2 = calp2 * cbet2;
+      double comg2 = csig2;
+      norm(ssig2, csig2);
+
+      // sig12 = sig2 - sig1 and omg12 = omg2 - omg1, limited to [0, pi]
+      sig12 = std::atan2(std::max(0.0, csig1 * ssig2 - ssig1 * csig2) + 0.0,
+                         csig1 * csig2 + ssig1 * ssig2);
+      double somg12 = std::max(0.0, comg1 * somg2 - somg1 * comg2) + 0.0;
+      double comg12 = comg1 * comg2 + somg1 * somg2;
+      double eta = std::atan2(somg12 * clam120 - comg12 * slam120,
+                              comg12 * clam120 + somg12 * slam120);
+
+      double C3a[ORDER];
+      eps = epsilon(sq(calp0) * EP2);
+      C3f(eps, C3a);
+      double B312 = sinSeries(ssig2, csig2, C3a, ORDER - 1) -
+        sinSeries(ssig1, csig1, C3a, ORDER - 1);
+      double lam12 = eta - F * A3f(eps) * salp0 * (sig12 + B312);
+
+      if (diffp)
+      {
+        if (calp2 == 0)
+        {
+          dlam12 = -2 * F1 * dn1 / sbet1;
+        }
+        else
+        {
+          double dummy = 0;
+          lengths(eps, sig12, ssig1, csig1, dn1, ssig2, csig2, dn2,
+                  false, true, dummy, dlam12);
+          dlam12 *= F1 / (calp2 * cbet2);
+        }
+      }
+      return lam12;
+    }
+
+    //! @brief Per-point terms of the inverse problem
+    //!
+    //! Everything that depends on one endpoint only, so a matrix computes it
+    //! once per row and column rather than once per pair.
+    struct Endpoint
+    {
+      //! @brief Rounded latitude, NaN if out of range [dec. degrees]
+      double lat;
+      double lon;
+      //! @brief lon reduced to [-180, 180] [dec. degrees]
+      double lonr;
+      //! @brief Reduced latitude of |lat|, and dn = sqrt(1 + ep2 sbet^2)
+      double sbet;
+      double cbet;
+      double dn;
+    };
+
+    Endpoint makeEndpoint(double lat, double lon)
+    {
+      Endpoint p;
+      p.lat = angRound(latFix(lat));
+      p.lon = lon;
+      p.lonr = std::isfinite(lon) ? std::remainder(lon, 360.0) :
+        std::numeric_limits<double>::quiet_NaN();
+      sincosd(p.lat, p.sbet, p.cbet);
+      p.sbet *= F1;
+      norm(p.sbet, p.cbet);
+      // cbet = +epsilon at the poles
+      p.cbet = std::max(TINY, p.cbet);
+      p.dn = std::sqrt(1 + EP2 * sq(p.sbet));
+      return p;
+    }
+
+    //! @brief Solve the inverse problem between two endpoints
+    //! @return s12 [m]; the azimuths are returned as sin/cos pairs
+    double inverse(const Endpoint &p1, const Endpoint &p2,
+                   double &salp1, double &calp1,
+                   double &salp2, double &calp2)
+    {
+      // Longitude difference in [-180, 180], carefully
+      double lon12s = 0;
+      double lon12 = sum(-p1.lonr, p2.lonr, lon12s);
+      lon12 = sum(std::remainder(lon12, 360.0), lon12s, lon12s);
+      if (lon12 == 0 || std::fabs(lon12) == 180)
+      {
+        lon12 = std::copysign(lon12, lon12s == 0 ? p2.lon - p1.lon : -lon12s);
+      }
+      // Make the longitude difference positive
+      double lonsign = std::copysign(1.0, lon12);
+      lon12 *= lonsign;
+      lon12s *= lonsign;
+      double lam12 = lon12 * DEG;
+      double slam12;
+      double clam12;
+      sincosde(lon12, lon12s, slam12, clam12);
+      // Supplementary longitude difference
+      lon12s = (180 - lon12) - lon12s;
+
+      // Swap so the point with the larger |lat| is point 1, then make
+      // lat1 <= 0.  Then 0 <= lon12 <= 180 and lat1 <= lat2 <= -lat1.
+      const Endpoint *a = &p1;
+      const Endpoint *b = &p2;
+      double swapp = std::fabs(p1.lat) < std::fabs(p2.lat) ||
+        std::isnan(p2.lat) ? -1 : 1;
+      if (swapp < 0)
+      {
+        lonsign *= -1;
+        std::swap(a, b);
+      }
+      double latsign = std::copysign(1.0, -a->lat);
+      double lat1 = latsign * a->lat;
+      double sbet1 = latsign * a->sbet;
+      double cbet1 = a->cbet;
+      double dn1 = a->dn;
+      double sbet2 = latsign * b->sbet;
+      double cbet2 = b->cbet;
+      double dn2 = b->dn;
+
+      // Force bet2 = +/- bet1 exactly when they only differ by rounding
+      if (cbet1 < -sbet1)
+      {
+        if (cbet2 == cbet1)
+        {
+          sbet2 = std::copysign(sbet1, sbet2);
+          dn2 = dn1;
+        }
+      }
+      else if (std::fabs(sbet2) == -sbet1)
+      {
+        cbet2 = cbet1;
+      }
+
+      double s12x = 0;
+      double m12x = 0;
+      double sig12 = 0;
+      bool meridian = lat1 == -90 || slam12 == 0;
+
+      if (meridian)
+      {
+        // The end points are on a single full meridian, so the geodesic
+        // might lie on it
+        calp1 = clam12;
+        salp1 = slam12;
+        calp2 = 1;
+        salp2 = 0;
+
+        double ssig1 = sbet1;
+        double csig1 = calp1 * cbet1;
+        double ssig2 = sbet2;
+        double csig2 = calp2 * cbet2;
+        sig12 = std::atan2(std::max(0.0, csig1 * ssig2 - ssig1 * csig2) + 0.0,
+                           csig1 * csig2 + ssig1 * ssig2);
+        lengths(N, sig12, ssig1, csig1, dn1, ssig2, csig2, dn2,
+                true, true, s12x, m12x);
+
+        // m12 < 0 means the meridian isn't the shortest path
+        if (sig12 < TOL2 || m12x >= 0)
+        {
+          if (sig12 < 3 * TINY ||
+              (sig12 < TOL0 && (s12x < 0 || m12x < 0)))
+          {
+            sig12 = m12x = s12x = 0;
+          }
+          s12x *= B;
+        }
+        else
+        {
+          meridian = false;
+        }
+      }
+
+      if (!meridian && sbet1 == 0 && lon12s >= F * 180)
+      {
+        // Along the equator
+        calp1 = calp2 = 0;
+        salp1 = salp2 = 1;
+        s12x = A * lam12;
+      }
+      else if (!meridian)
+      {
+        double dnm = 0;
+        sig12 = inverseStart(sbet1, cbet1, sbet2, cbet2,
+                             lam12, slam12, clam12,
+                             salp1, calp1, salp2, calp2, dnm);
+        if (sig12 >= 0)
+        {
+          // Short line, solved by inverseStart
+          s12x = sig12 * B * dnm;
+        }
+        else
+        {
+          // Newton's method on lambda12(alp1) - lam12 = 0, restarted from
+          // the middle of the bracket (alp1a, alp1b) whenever a step
+          // leaves it
+          double ssig1 = 0;
+          double csig1 = 0;
+          double ssig2 = 0;
+          double csig2 = 0;
+          double eps = 0;
+          int numit = 0;
+          bool tripn = false;
+          bool tripb = false;
+          double salp1a = TINY;
+          double calp1a = 1;
+          double salp1b = TINY;
+          double calp1b = -1;
+
+          for (;; ++numit)
+          {
+            double dv = 0;
+            double v = lambda12(sbet1, cbet1, dn1, sbet2, cbet2, dn2,
+                                salp1, calp1, slam12, clam12,
+                                numit < MAXIT1,
+                                salp2, calp2, sig12,
+                                ssig1, csig1, ssig2, csig2, eps, dv);
+            // Reversed test to allow escape with NaNs
+            if (tripb || !(std::fabs(v) >= (tripn ? 8 : 1) * TOL0) ||
+                numit == MAXIT2)
+            {
+              break;
+            }
+            // Update the bracket
+            if (v > 0 && (numit > MAXIT1 || calp1 / salp1 > calp1b / salp1b))
+            {
+              salp1b = salp1;
+              calp1b = calp1;
+            }
+            else if (v < 0 &&
+                     (numit > MAXIT1 || calp1 / salp1 < calp1a / salp1a))
+            {
+              salp1a = salp1;
+              calp1a = calp1;
+            }
+            if (numit < MAXIT1 && dv > 0)
+            {
+              double dalp1 = -v / dv;
+              if (std::fabs(dalp1) < M_PI)
+              {
+                double sdalp1 = std::sin(dalp1);
+                double cdalp1 = std::cos(dalp1);
+                double nsalp1 = salp1 * cdalp1 + calp1 * sdalp1;
+                if (nsalp1 > 0)
+                {
+                  calp1 = calp1 * cdalp1 - salp1 * sdalp1;
+                  salp1 = nsalp1;
+                  norm(salp1, calp1);
+                  // Convergence may be linear when the slope -> 0
+                  tripn = std::fabs(v) <= 16 * TOL0;
+                  continue;
+                }
+              }
+            }
+            salp1 = (salp1a + salp1b) / 2;
+            calp1 = (calp1a + calp1b) / 2;
+            norm(salp1, calp1);
+            tripn = false;
+            tripb = (std::fabs(salp1a - salp1) + (calp1a - calp1) < TOLB ||
+                     std::fabs(salp1 - salp1b) + (calp1 - calp1b) < TOLB);
+          }
+
+          double dummy = 0;
+          lengths(eps, sig12, ssig1, csig1, dn1, ssig2, csig2, dn2,
+                  true, false, s12x, dummy);
+          s12x *= B;
+        }
+      }
+
+      // Undo the canonical transformation on the azimuths
+      if (swapp < 0)
+      {
+        std::swap(salp1, salp2);
+        std::swap(calp1, calp2);
+      }
+      salp1 *= swapp * lonsign;
+      calp1 *= swapp * latsign;
+      salp2 *= swapp * lonsign;
+      calp2 *= swapp * latsign;
+      return 0.0 + s12x;
+    }
+
+    void inverse(const Endpoint &p1, const Endpoint &p2,
+                 double *s12, double *azi1, double *azi2)
+    {
+      double salp1, calp1, salp2, calp2;
+      double s = inverse(p1, p2, salp1, calp1, salp2, calp2);
+      if (s12)
+      {
+        *s12 = s;
+      }
+      if (azi1)
+      {
+        *azi1 = atan2d(salp1, calp1);
+      }
+      if (azi2)
+      {
+        *azi2 = atan2d(salp2, calp2);
+      }
+    }
+
+    //! @brief Points per block of distanceMatrix() and densify()
+    const size_t BLOCK_SIZE = 256;
+
+    //! @brief Azimuth of the reversed geodesic [dec. degrees]
+    double reverseAzimuth(double azi)
+    {
+      return azi > 0 ? azi - 180 : azi + 180;
+    }
+
+    //! @brief Rows [row_begin, row_end) of distanceMatrix()
+    //!
+    //! When symmetric is set (the rows and columns are the same points), only
+    //! the upper triangle is solved and mirrored into the lower one, so the
+    //! rows of different calls never write the same element.
+    void distanceRows(const double *lat1, const double *lon1,
+                      size_t row_begin, size_t row_end,
+                      const double *lat2, const double *lon2, size_t cols,
+                      bool symmetric,
+                      double *s12, double *azi1, double *azi2)
+    {
+      Endpoint block[BLOCK_SIZE];
+      const bool want_azi = azi1 || azi2;
+      const size_t col_begin = symmetric ? row_begin : 0;
+      for (size_t cb = col_begin; cb < cols; cb += BLOCK_SIZE)
+      {
+        const size_t n = std::min(BLOCK_SIZE, cols - cb);
+        for (size_t c = 0; c < n; ++c)
+        {
+          block[c] = makeEndpoint(lat2[cb + c], lon2[cb + c]);
+        }
+        const size_t rows_end = symmetric ? std::min(row_end, cb + n) : row_end;
+        for (size_t r = row_begin; r < rows_end; ++r)
+        {
+          const Endpoint p1 = makeEndpoint(lat1[r], lon1[r]);
+          const size_t first = symmetric && r > cb ? r - cb : 0;
+          for (size_t c = first; c < n; ++c)
+          {
+            const size_t o = r * cols + cb + c;
+            double s, a1, a2;
+            inverse(p1, block[c], &s, want_azi ? &a1 : NULL,
+                    want_azi ? &a2 : NULL);
+            if (s12)
+            {
+              s12[o] = s;
+            }
+            if (azi1)
+            {
+              azi1[o] = a1;
+            }
+            if (azi2)
+            {
+              azi2[o] = a2;
+            }
+            const size_t m = (cb + c) * cols + r;
+            if (symmetric && m != o)
+            {
+              if (s12)
+              {
+                s12[m] = s;
+              }
+              if (azi1)
+              {
+                azi1[m] = reverseAzimuth(a2);
+              }
+              if (azi2)
+              {
+                azi2[m] = reverseAzimuth(a1);
+              }
+            }
+          }
+        }
+      }
+    }
+
+    //! @brief Output of densify(), projected a block at a time
+    class PathWriter
+    {
+      public:
+        PathWriter(const GeonavBatch::Datum &datum, double *x, double *y,
+                   double *param, size_t capacity) :
+          datum_(datum), x_(x), y_(y), param_(param), capacity_(capacity),
+          count_(0), written_(0), pending_(0)
+        {
+        }
+
+        void add(double lat, double lon, double param)
+        {
+          if (count_ < capacity_)
+          {
+            lat_[pending_] = lat;
+            lon_[pending_] = lon;
+            if (param_)
+            {
+              param_[count_] = param;
+            }
+            if (++pending_ == BLOCK_SIZE)
+            {
+              flush();
+            }
+          }
+          ++count_;
+        }
+
+        //! @return total number of points added
+        size_t flush()
+        {
+          GeonavBatch::LLtoLocal(datum_, lat_, lon_, pending_,
+                                 x_ + written_, y_ + written_);
+          written_ += pending_;
+          pending_ = 0;
+          return count_;
+        }
+
+      private:
+        const GeonavBatch::Datum &datum_;
+        double *x_;
+        double *y_;
+        double *param_;
+        size_t capacity_;
+        size_t count_;
+        size_t written_;
+        size_t pending_;
+        double lat_[BLOCK_SIZE];
+        double lon_[BLOCK_SIZE];
+    };
+
+    //! @brief Deviation of a point from the line through two others
+    double chordDeviation(double x0, double y0, double x1, double y1,
+                          double xm, double ym)
+    {
+      const double dx = x1 - x0;
+      const double dy = y1 - y0;
+      const double len = std::hypot(dx, dy);
+      return len > 0 ? std::fabs(dx * (ym - y0) - dy * (xm - x0)) / len :
+        std::hypot(xm - x0, ym - y0);
+    }
+
+    //! @brief Largest deviation of the step midpoints from their chords,
+    //! splitting a leg into equal steps
+    double stepDeviation(const GeonavBatch::Datum &datum,
+                         const GeodesicLine &line, double s12, size_t steps)
+    {
+      double lat[2];
+      double lon[2];
+      double x[2];
+      double y[2];
+      double azi;
+      line.position(0, lat[0], lon[0], azi);
+      GeonavBatch::LLtoLocal(datum, lat, lon, 1, x, y);
+      double x0 = x[0];
+      double y0 = y[0];
+      double worst = 0;
+      for (size_t k = 0; k < steps; ++k)
+      {
+        // Midpoint and end of step k
+        line.position((k + 0.5) / steps * s12, lat[0], lon[0], azi);
+        line.position(static_cast<double>(k + 1) / steps * s12,
+                      lat[1], lon[1], azi);
+        GeonavBatch::LLtoLocal(datum, lat, lon, 2, x, y);
+        worst = std::max(worst, chordDeviation(x0, y0, x[1], y[1], x[0], y[0]));
+        x0 = x[1];
+        y0 = y[1];
+      }
+      return worst;
+    }
+
+    //! @brief Number of equal steps, at least steps, keeping the chords
+    //! within tolerance
+    //!
+    //! The deviation of a step's midpoint from its chord is the sagitta,
+    //! which shrinks with the square of the step length.  The first guess
+    //! comes from the whole leg; the projected curvature isn't uniform, so
+    //! the steps are checked and refined a few times.
+    size_t toleranceSteps(const GeonavBatch::Datum &datum,
+                          const GeodesicLine &line, double s12,
+                          size_t steps, double tolerance)
+    {
+      for (int iteration = 0; iteration < 4; ++iteration)
+      {
+        const double dev = stepDeviation(datum, line, s12, steps);
+        if (!(dev > tolerance))
+        {
+          break;
+        }
+        // 10% margin so a refinement rarely needs another pass
+        const double n = std::ceil(1.1 * steps * std::sqrt(dev / tolerance));
+        if (!std::isfinite(n))
+        {
+          break;
+        }
+        steps = std::max(steps + 1, static_cast<size_t>(n));
+      }
+      return steps;
+    }
+
+    bool isSymmetric(const double *lat1, const double *lon1, size_t rows,
+                     const double *lat2, const double *lon2, size_t cols)
+    {
+      return lat1 == lat2 && lon1 == lon2 && rows == cols;
+    }
+  }  // namespace
+
+  void inverse(double lat1, double lon1, double lat2, double lon2,
+               double &s12, double &azi1, double &azi2)
+  {
+    inverse(makeEndpoint(lat1, lon1), makeEndpoint(lat2, lon2),
+            &s12, &azi1, &azi2);
+  }
+
+  double distance(double lat1, double lon1, double lat2, double lon2)
+  {
+    double salp1, calp1, salp2, calp2;
+    return inverse(makeEndpoint(lat1, lon1), makeEndpoint(lat2, lon2),
+                   salp1, calp1, salp2, calp2);
+  }
+
+  void direct(double lat1, double lon1, double azi1, double s12,
+              double &lat2, double &lon2, double &azi2)
+  {
+    GeodesicLine(lat1, lon1, azi1).position(s12, lat2, lon2, azi2);
+  }
+
+  GeodesicLine::GeodesicLine(double lat1, double lon1, double azi1) :
+    lon1_(lon1)
+  {
+    double salp1;
+    double calp1;
+    sincosd(angRound(azi1), salp1, calp1);
+
+    double sbet1;
+    double cbet1;
+    sincosd(angRound(latFix(lat1)), sbet1, cbet1);
+    sbet1 *= F1;
+    norm(sbet1, cbet1);
+    cbet1 = std::max(TINY, cbet1);
+
+    // alp0 is the azimuth at the equator crossing; sig and omg are
+    // measured from the northward crossing on the auxiliary sphere
+    salp0_ = salp1 * cbet1;
+    calp0_ = std::hypot(calp1, salp1 * sbet1);
+    ssig1_ = sbet1;
+    somg1_ = salp0_ * sbet1;
+    csig1_ = comg1_ = sbet1 != 0 || calp1 != 0 ? cbet1 * calp1 : 1;
+    norm(ssig1_, csig1_);
+
+    double eps = epsilon(sq(calp0_) * EP2);
+    double C1a[ORDER + 1];
+    A1m1_ = A1m1f(eps);
+    C1f(eps, C1a);
+    B11_ = sinSeries(ssig1_, csig1_, C1a, ORDER);
+    double s = std::sin(B11_);
+    double c = std::cos(B11_);
+    // tau1 = sig1 + B11
+    stau1_ = ssig1_ * c + csig1_ * s;
+    ctau1_ = csig1_ * c - ssig1_ * s;
+    C1pf(eps, C1pa_);
+
+    C3f(eps, C3a_);
+    A3c_ = -F * salp0_ * A3f(eps);
+    B31_ = sinSeries(ssig1_, csig1_, C3a_, ORDER - 1);
+  }
+
+  void GeodesicLine::position(double s12, double &lat2, double &lon2,
+                              double &azi2) const
+  {
+    double tau12 = s12 / (B * (1 + A1m1_));
+    double s = std::sin(tau12);
+    double c = std::cos(tau12);
+    // tau2 = tau1 + tau12, reverted to sig12 with the C1' series
+    double B12 = -sinSeries(stau1_ * c + ctau1_ * s,
+                            ctau1_ * c - stau1_ * s, C1pa_, ORDER);
+    double sig12 = tau12 - (B12 - B11_);
+    double ssig12 = std::sin(sig12);
+    double csig12 = std::cos(sig12);
+
+    double ssig2 = ssig1_ * csig12 + csig1_ * ssig12;
+    double csig2 = csig1_ * csig12 - ssig1_ * ssig12;
+    double sbet2 = calp0_ * ssig2;
+    double cbet2 = std::hypot(salp0_, calp0_ * csig2);
+    if (cbet2 == 0)
+    {
+      // salp0 = 0 and csig2 = 0, break the degeneracy
+      cbet2 = csig2 = TINY;
+    }
+    double salp2 = salp0_;
+    double calp2 = calp0_ * csig2;
+
+    double somg2 = salp0_ * ssig2;
+    double comg2 = csig2;
+    double omg12 = std::atan2(somg2 * comg1_ - comg2 * somg1_,
+                              comg2 * comg1_ + somg2 * somg1_);
+    double lam12 = omg12 + A3c_ *
+      (sig12 + (sinSeries(ssig2, csig2, C3a_, ORDER - 1) - B31_));
+
+    lat2 = atan2d(sbet2, F1 * cbet2);
+    lon2 = angNormalize(angNormalize(lon1_) + angNormalize(lam12 / DEG));
+    azi2 = atan2d(salp2, calp2);
+  }
+
+  void inverse(const double *lat1, const double *lon1,
+               const double *lat2, const double *lon2, size_t count,
+               double *s12, double *azi1, double *azi2)
+  {
+    for (size_t i = 0; i < count; ++i)
+    {
+      inverse(makeEndpoint(lat1[i], lon1[i]), makeEndpoint(lat2[i], lon2[i]),
+              s12 ? s12 + i : NULL, azi1 ? azi1 + i : NULL,
+              azi2 ? azi2 + i : NULL);
+    }
+  }
+
+  void direct(const double *lat1, const double *lon1,
+              const double *azi1, const double *s12, size_t count,
+              double *lat2, double *lon2, double *azi2)
+  {
+    for (size_t i = 0; i < count; ++i)
+    {
+      double la, lo, az;
+      GeodesicLine(lat1[i], lon1[i], azi1[i]).position(s12[i], la, lo, az);
+      if (lat2)
+      {
+        lat2[i] = la;
+      }
+      if (lon2)
+      {
+        lon2[i] = lo;
+      }
+      if (azi2)
+      {
+        azi2[i] = az;
+      }
+    }
+  }
+
+  void distanceMatrix(const double *lat1, const double *lon1, size_t rows,
+                      const double *lat2, const double *lon2, size_t cols,
+                      double *s12, double *azi1, double *azi2)
+  {
+    distanceRows(lat1, lon1, 0, rows, lat2, lon2, cols,
+                 isSymmetric(lat1, lon1, rows, lat2, lon2, cols),
+                 s12, azi1, azi2);
+  }
+
+  void distanceMatrixAsync(
+    const double *lat1, const double *lon1, size_t rows,
+    const double *lat2, const double *lon2, size_t cols,
+    double *s12, double *azi1, double *azi2,
+    const GeonavBatch::BatchCallback &done,
+    const GeonavBatch::BatchOptions &options)
+  {
+    GeonavBatch::BatchOptions row_options = options;
+    row_options.chunk_size = std::max<size_t>(options.chunk_size /
+                                              std::max<size_t>(cols, 1), 1);
+    const bool symmetric = isSymmetric(lat1, lon1, rows, lat2, lon2, cols);
+    GeonavBatch::runChunked(rows, [=](size_t b, size_t e)
+    {
+      distanceRows(lat1, lon1, b, e, lat2, lon2, cols, symmetric,
+                   s12, azi1, azi2);
+    }, done, row_options);
+  }
+
+  std::future<size_t> distanceMatrixAsync(
+    const double *lat1, const double *lon1, size_t rows,
+    const double *lat2, const double *lon2, size_t cols,
+    double *s12, double *azi1, double *azi2,
+    const GeonavBatch::BatchOptions &options)
+  {
+    std::shared_ptr<std::promise<size_t> > promise =
+      std::make_shared<std::promise<size_t> >();
+    std::future<size_t> future = promise->get_future();
+    distanceMatrixAsync(lat1, lon1, rows, lat2, lon2, cols, s12, azi1, azi2,
+                        [promise](size_t computed)
+                        { promise->set_value(computed); },
+                        options);
+    return future;
+  }
+
+  size_t densify(const GeonavBatch::Datum &datum,
+                 const double *lat, const double *lon, size_t count,
+                 double spacing, double tolerance,
+                 double *x, double *y, double *param, size_t capacity)
+  {
+    PathWriter writer(datum, x, y, param, capacity);
+    if (count > 0)
+    {
+      writer.add(lat[0], lon[0], 0);
+    }
+    for (size_t i = 0; i + 1 < count; ++i)
+    {
+      double s12, azi1, azi2;
+      inverse(lat[i], lon[i], lat[i + 1], lon[i + 1], s12, azi1, azi2);
+      GeodesicLine line(lat[i], lon[i], azi1);
+
+      size_t steps = 1;
+      if (s12 > 0 && spacing > 0)
+      {
+        const double n = std::ceil(s12 / spacing);
+        steps = std::isfinite(n) && n > 1 ? static_cast<size_t>(n) : 1;
+      }
+      if (s12 > 0 && tolerance > 0)
+      {
+        steps = toleranceSteps(datum, line, s12, steps, tolerance);
+      }
+      for (size_t j = 1; j < steps; ++j)
+      {
+        const double f = static_cast<double>(j) / steps;
+        double la, lo, az;
+        line.position(f * s12, la, lo, az);
+        writer.add(la, lo, i + f);
+      }
+      writer.add(lat[i + 1], lon[i + 1], i + 1);
+    }
+    return writer.flush();
+  }
+
+}  // namespace GeonavGeodesic
+}  // namespace GeonavTransform
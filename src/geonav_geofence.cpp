@@ -0,0 +1,335 @@
+/*
+
+Copyright (c) 2017, Brian Bingham
+All rights reserved
+
+This file is part of the geonav_transform package.
+
+Geonav_transform is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Geonav_transform is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this package.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "geonav_transform/geonav_geofence.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace GeonavTransform
+{
+  namespace
+  {
+    //! @brief Largest number of grid cells
+    const double MAX_CELLS = 4.0e6;
+
+    //! @brief Largest number of cell center flags, cells * polygons (4 MB)
+    const double MAX_CENTER_BITS = 3.2e7;
+
+    //! @brief Squared distance from (x, y) to a segment
+    double segmentDistance2(double x, double y,
+                            double x0, double y0, double x1, double y1)
+    {
+      const double dx = x1 - x0;
+      const double dy = y1 - y0;
+      const double len2 = dx*dx + dy*dy;
+      double t = (len2 > 0.0) ? ((x - x0)*dx + (y - y0)*dy) / len2 : 0.0;
+      t = std::min(1.0, std::max(0.0, t));
+      const double ex = x0 + t*dx - x;
+      const double ey = y0 + t*dy - y;
+      return ex*ex + ey*ey;
+    }
+
+    //! @brief Which side of the line through a, b the point p is on
+    bool leftOf(double ax, double ay, double bx, double by, double px, double py)
+    {
+      return (bx - ax)*(py - ay) - (by - ay)*(px - ax) > 0.0;
+    }
+  }  // namespace
+
+Geofence::Geofence() :
+  has_keep_in_(false),
+  min_x_(0.0),
+  min_y_(0.0),
+  cell_size_(1.0),
+  nx_(0),
+  ny_(0)
+{
+  polygon_start_.push_back(0);
+}
+
+size_t Geofence::addPolygon(const double *x, const double *y, size_t count,
+                            bool keep_out)
+{
+  const int polygon = static_cast<int>(keep_out_.size());
+  keep_out_.push_back(keep_out);
+  has_keep_in_ = has_keep_in_ || !keep_out;
+  for (size_t i = 0; i < count; ++i)
+  {
+    const size_t j = (i + 1) % count;
+    Edge edge = {x[i], y[i], x[j], y[j], polygon};
+    edges_.push_back(edge);
+  }
+  polygon_start_.push_back(edges_.size());
+  return polygon;
+}
+
+size_t Geofence::addPolygon(const GeonavBatch::Datum &datum,
+                            const double *lat, const double *lon, size_t count,
+                            bool keep_out)
+{
+  std::vector<double> x(count);
+  std::vector<double> y(count);
+  GeonavBatch::LLtoLocal(datum, lat, lon, count, x.data(), y.data());
+  return addPolygon(x.data(), y.data(), count, keep_out);
+}
+
+size_t Geofence::size() const
+{
+  return keep_out_.size();
+}
+
+void Geofence::build(double cell_size)
+{
+  const size_t polygons = size();
+  scratch_.assign(polygons, 0);
+  if (edges_.empty())
+  {
+    nx_ = ny_ = 0;
+    return;
+  }
+
+  // Bounding box of all edges, padded by a cell
+  double max_x = -std::numeric_limits<double>::infinity();
+  double max_y = max_x;
+  min_x_ = std::numeric_limits<double>::infinity();
+  min_y_ = min_x_;
+  for (size_t e = 0; e < edges_.size(); ++e)
+  {
+    min_x_ = std::min(min_x_, edges_[e].x0);
+    min_y_ = std::min(min_y_, edges_[e].y0);
+    max_x = std::max(max_x, edges_[e].x0);
+    max_y = std::max(max_y, edges_[e].y0);
+  }
+  cell_size_ = (cell_size > 0.0) ? cell_size : 1.0;
+  // The center flags grow with the polygons, so many fences get coarser
+  // cells rather than a huge table
+  for (;;)
+  {
+    const double estimate = ((max_x - min_x_)/cell_size_ + 3) *
+      ((max_y - min_y_)/cell_size_ + 3);
+    if (estimate <= MAX_CELLS && estimate * polygons <= MAX_CENTER_BITS)
+    {
+      break;
+    }
+    cell_size_ *= 2.0;
+  }
+  min_x_ -= cell_size_;
+  min_y_ -= cell_size_;
+  nx_ = static_cast<int>((max_x - min_x_) / cell_size_) + 2;
+  ny_ = static_cast<int>((max_y - min_y_) / cell_size_) + 2;
+  const size_t cells = static_cast<size_t>(nx_) * ny_;
+
+  // Edges by cell, over the cells of each edge's bounding box
+  cell_start_.assign(cells + 1, 0);
+  for (int pass = 0; pass < 2; ++pass)
+  {
+    std::vector<uint32_t> fill;
+    if (pass == 1)
+    {
+      for (size_t c = 0; c < cells; ++c)
+      {
+        cell_start_[c+1] += cell_start_[c];
+      }
+      cell_edges_.resize(cell_start_[cells]);
+      fill.assign(cell_start_.begin(), cell_start_.end() - 1);
+    }
+    for (size_t e = 0; e < edges_.size(); ++e)
+    {
+      const Edge &edge = edges_[e];
+      const int cx0 = static_cast<int>((std::min(edge.x0, edge.x1) - min_x_) / cell_size_);
+      const int cx1 = static_cast<int>((std::max(edge.x0, edge.x1) - min_x_) / cell_size_);
+      const int cy0 = static_cast<int>((std::min(edge.y0, edge.y1) - min_y_) / cell_size_);
+      const int cy1 = static_cast<int>((std::max(edge.y0, edge.y1) - min_y_) / cell_size_);
+      for (int cy = cy0; cy <= cy1; ++cy)
+      {
+        for (int cx = cx0; cx <= cx1; ++cx)
+        {
+          const size_t c = static_cast<size_t>(cy) * nx_ + cx;
+          if (pass == 0)
+          {
+            ++cell_start_[c+1];
+          }
+          else
+          {
+            cell_edges_[fill[c]++] = static_cast<uint32_t>(e);
+          }
+        }
+      }
+    }
+  }
+
+  // Inside/outside of every cell center, one scanline per row and polygon
+  center_inside_.assign((cells * polygons + 63) / 64, 0);
+  std::vector<double> crossings;
+  for (int cy = 0; cy < ny_; ++cy)
+  {
+    const double yc = min_y_ + (cy + 0.5) * cell_size_;
+    for (size_t p = 0; p < polygons; ++p)
+    {
+      crossings.clear();
+      for (size_t e = polygon_start_[p]; e < polygon_start_[p+1]; ++e)
+      {
+        const Edge &edge = edges_[e];
+        if ((edge.y0 > yc) != (edge.y1 > yc))
+        {
+          crossings.push_back(edge.x0 + (yc - edge.y0) * (edge.x1 - edge.x0)
+                              / (edge.y1 - edge.y0));
+        }
+      }
+      std::sort(crossings.begin(), crossings.end());
+      size_t k = 0;
+      for (int cx = 0; cx < nx_; ++cx)
+      {
+        const double xc = min_x_ + (cx + 0.5) * cell_size_;
+        while (k < crossings.size() && crossings[k] < xc)
+        {
+          ++k;
+        }
+        const size_t bit = p * cells + static_cast<size_t>(cy) * nx_ + cx;
+        center_inside_[bit / 64] |= static_cast<uint64_t>(k % 2) << (bit % 64);
+      }
+    }
+  }
+}
+
+void Geofence::nearestInCell(int cx, int cy, double x, double y,
+                             double &best, int &polygon) const
+{
+  const size_t c = static_cast<size_t>(cy) * nx_ + cx;
+  for (uint32_t i = cell_start_[c]; i < cell_start_[c+1]; ++i)
+  {
+    const Edge &edge = edges_[cell_edges_[i]];
+    const double d2 = segmentDistance2(x, y, edge.x0, edge.y0, edge.x1, edge.y1);
+    if (d2 < best)
+    {
+      best = d2;
+      polygon = edge.polygon;
+    }
+  }
+}
+
+Geofence::Result Geofence::check(double x, double y) const
+{
+  Result result;
+  result.inside = true;
+  result.distance = std::numeric_limits<double>::infinity();
+  result.polygon = -1;
+  if (edges_.empty() || nx_ == 0)
+  {
+    return result;
+  }
+
+  const size_t polygons = size();
+  const double fx = std::floor((x - min_x_) / cell_size_);
+  const double fy = std::floor((y - min_y_) / cell_size_);
+  const bool in_grid = (fx >= 0 && fy >= 0 && fx < nx_ && fy < ny_);
+  double best = std::numeric_limits<double>::infinity();
+
+  if (in_grid)
+  {
+    const int cx = static_cast<int>(fx);
+    const int cy = static_cast<int>(fy);
+    const size_t c = static_cast<size_t>(cy) * nx_ + cx;
+
+    // Containment: the cell center's, flipped by every polygon edge
+    // between the center and the point (all such edges are in this cell)
+    const double xc = min_x_ + (cx + 0.5) * cell_size_;
+    const double yc = min_y_ + (cy + 0.5) * cell_size_;
+    const size_t cells = static_cast<size_t>(nx_) * ny_;
+    for (size_t p = 0; p < polygons; ++p)
+    {
+      const size_t bit = p * cells + c;
+      scratch_[p] = (center_inside_[bit / 64] >> (bit % 64)) & 1;
+    }
+    for (uint32_t i = cell_start_[c]; i < cell_start_[c+1]; ++i)
+    {
+      const Edge &edge = edges_[cell_edges_[i]];
+      if (leftOf(xc, yc, x, y, edge.x0, edge.y0) !=
+          leftOf(xc, yc, x, y, edge.x1, edge.y1) &&
+          leftOf(edge.x0, edge.y0, edge.x1, edge.y1, xc, yc) !=
+          leftOf(edge.x0, edge.y0, edge.x1, edge.y1, x, y))
+      {
+        scratch_[edge.polygon] ^= 1;
+      }
+    }
+
+    // Nearest edge, over growing rings of cells.  Cells of ring k are at
+    // least (k - 1) cells away, so stop once the best is closer than that.
+    const int rings = std::max(nx_, ny_);
+    for (int k = 0; k <= rings; ++k)
+    {
+      for (int j = cy - k; j <= cy + k; ++j)
+      {
+        if (j < 0 || j >= ny_)
+        {
+          continue;
+        }
+        const bool edge_row = (j == cy - k || j == cy + k);
+        for (int i = cx - k; i <= cx + k; i += (edge_row || k == 0) ? 1 : 2 * k)
+        {
+          if (i >= 0 && i < nx_)
+          {
+            nearestInCell(i, j, x, y, best, result.polygon);
+          }
+        }
+      }
+      const double reach = k * cell_size_;
+      if (best <= reach * reach)
+      {
+        break;
+      }
+    }
+  }
+  else
+  {
+    // Far from the fence - outside every polygon, nearest edge by brute force
+    std::fill(scratch_.begin(), scratch_.end(), 0);
+    for (size_t e = 0; e < edges_.size(); ++e)
+    {
+      const Edge &edge = edges_[e];
+      const double d2 = segmentDistance2(x, y, edge.x0, edge.y0, edge.x1, edge.y1);
+      if (d2 < best)
+      {
+        best = d2;
+        result.polygon = edge.polygon;
+      }
+    }
+  }
+
+  bool in_keep_in = !has_keep_in_;
+  bool in_keep_out = false;
+  for (size_t p = 0; p < polygons; ++p)
+  {
+    if (scratch_[p])
+    {
+      in_keep_out = in_keep_out || keep_out_[p];
+      in_keep_in = in_keep_in || !keep_out_[p];
+    }
+  }
+  result.inside = in_keep_in && !in_keep_out;
+  result.distance = std::sqrt(best) * (result.inside ? 1.0 : -1.0);
+  return result;
+}
+
+}  // namespace GeonavTransform
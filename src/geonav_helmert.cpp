@@ -0,0 +1,243 @@
+/*
+
+Copyright (c) 2017, Brian Bingham
+All rights reserved
+
+This file is part of the geonav_transform package.
+
+Geonav_transform is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Geonav_transform is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this package.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "geonav_transform/geonav_helmert.h"
+#include "geonav_transform/navsat_conversions.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+
+namespace GeonavTransform
+{
+namespace GeonavHelmert
+{
+  namespace
+  {
+    const size_t BLOCK_SIZE = 256;
+    const double RADIANS_PER_ARCSEC = M_PI / (180.0 * 3600.0);
+
+    const Ellipsoid WGS84_ELLIPSOID = {6378137.0, 298.257223563};
+    const Ellipsoid GRS80 = {6378137.0, 298.257222101};
+    const Ellipsoid CLARKE_1866 = {6378206.4, 294.9786982};
+    const Ellipsoid INTERNATIONAL_1924 = {6378388.0, 297.0};
+    const Ellipsoid AIRY_1830 = {6377563.396, 299.3249646};
+    const Ellipsoid BESSEL_1841 = {6377397.155, 299.1528128};
+    const Ellipsoid KRASSOWSKY_1940 = {6378245.0, 298.3};
+
+    // Parameters of the EPSG transformations noted, position vector
+    // convention.  Three parameter entries are regional means, good to a
+    // few metres.
+    const DatumParameters DATUMS[DATUM_COUNT] =
+    {
+      {"WGS84", WGS84_ELLIPSOID, 0, 0, 0, 0, 0, 0, 0},
+      // EPSG:1188, NAD83 taken as coincident with WGS84 (1-2 m)
+      {"NAD83", GRS80, 0, 0, 0, 0, 0, 0, 0},
+      // EPSG:1173, conterminous US
+      {"NAD27", CLARKE_1866, -8, 160, 176, 0, 0, 0, 0},
+      // EPSG:1133, western Europe
+      {"ED50", INTERNATIONAL_1924, -87, -98, -121, 0, 0, 0, 0},
+      // EPSG:1314, Great Britain
+      {"OSGB36", AIRY_1830, 446.448, -125.157, 542.06,
+       0.15, 0.247, 0.842, -20.489},
+      // EPSG:1777, Germany
+      {"DHDN", BESSEL_1841, 598.1, 73.7, 418.2, 0.202, 0.045, -2.455, 6.7},
+      // EPSG:1305, Japan
+      {"TOKYO", BESSEL_1841, -146.414, 507.337, 680.507, 0, 0, 0, 0},
+      // EPSG:1267, Russia
+      {"PULKOVO42", KRASSOWSKY_1940, 23.92, -141.27, -80.9,
+       0, 0.35, 0.82, -0.12}
+    };
+
+    double eccentricity2(double inverse_f)
+    {
+      const double f = 1.0 / inverse_f;
+      return f * (2 - f);
+    }
+
+    //! @brief Geodetic -> ECEF (a_in, e2_in) -> t + m X -> geodetic
+    //! (a_out, e2_out), one branch-free loop
+    void shiftPoints(const double *t, const double *m,
+                     double a_in, double e2_in, double a_out, double e2_out,
+                     const double *lat, const double *lon, const double *alt,
+                     size_t count,
+                     double *lat_out, double *lon_out, double *alt_out)
+    {
+      const double b_out = a_out * std::sqrt(1 - e2_out);
+      const double ep2_out = e2_out / (1 - e2_out);
+      for (size_t i = 0; i < count; ++i)
+      {
+        const double phi = lat[i] * NavsatConversions::RADIANS_PER_DEGREE;
+        const double lambda = lon[i] * NavsatConversions::RADIANS_PER_DEGREE;
+        const double h = alt ? alt[i] : 0.0;
+        const double sp = std::sin(phi);
+        const double cp = std::cos(phi);
+        const double N = a_in / std::sqrt(1 - e2_in * sp * sp);
+        const double x = (N + h) * cp * std::cos(lambda);
+        const double y = (N + h) * cp * std::sin(lambda);
+        const double z = (N * (1 - e2_in) + h) * sp;
+
+        const double X = t[0] + m[0] * x + m[1] * y + m[2] * z;
+        const double Y = t[1] + m[3] * x + m[4] * y + m[5] * z;
+        const double Z = t[2] + m[6] * x + m[7] * y + m[8] * z;
+
+        // Bowring, one step is sub-millimetre for terrestrial heights
+        const double p = std::sqrt(X * X + Y * Y);
+        const double theta = std::atan2(Z * a_out, p * b_out);
+        const double st = std::sin(theta);
+        const double ct = std::cos(theta);
+        const double phi_out = std::atan2(Z + ep2_out * b_out * st * st * st,
+                                          p - e2_out * a_out * ct * ct * ct);
+        const double so = std::sin(phi_out);
+        const double co = std::cos(phi_out);
+        lat_out[i] = phi_out * NavsatConversions::DEGREES_PER_RADIAN;
+        lon_out[i] = std::atan2(Y, X) * NavsatConversions::DEGREES_PER_RADIAN;
+        if (alt_out)
+        {
+          alt_out[i] = p * co + Z * so - a_out * std::sqrt(1 - e2_out * so * so);
+        }
+      }
+    }
+  }  // namespace
+
+  const DatumParameters &datumParameters(DatumId id)
+  {
+    return DATUMS[(id >= 0 && id < DATUM_COUNT) ? id : WGS84];
+  }
+
+  bool findDatum(const std::string &name, DatumId &id)
+  {
+    std::string upper(name);
+    std::transform(upper.begin(), upper.end(), upper.begin(), ::toupper);
+    for (int d = 0; d < DATUM_COUNT; ++d)
+    {
+      if (upper == DATUMS[d].name)
+      {
+        id = static_cast<DatumId>(d);
+        return true;
+      }
+    }
+    return false;
+  }
+
+  DatumShift datumShift(DatumId id)
+  {
+    return datumShift(datumParameters(id));
+  }
+
+  DatumShift datumShift(const DatumParameters &parameters)
+  {
+    DatumShift shift;
+    shift.a = parameters.ellipsoid.a;
+    shift.e2 = eccentricity2(parameters.ellipsoid.inverse_f);
+    shift.t[0] = parameters.tx;
+    shift.t[1] = parameters.ty;
+    shift.t[2] = parameters.tz;
+
+    const double rx = parameters.rx * RADIANS_PER_ARCSEC;
+    const double ry = parameters.ry * RADIANS_PER_ARCSEC;
+    const double rz = parameters.rz * RADIANS_PER_ARCSEC;
+    const double s = 1 + parameters.ds * 1e-6;
+    const double m[9] = {s,       -s * rz,  s * ry,
+                         s * rz,   s,      -s * rx,
+                        -s * ry,   s * rx,  s};
+    std::copy(m, m + 9, shift.m);
+
+    // Exact inverse, so fromWGS84 undoes toWGS84
+    double *inv = shift.m_inverse;
+    inv[0] = m[4] * m[8] - m[5] * m[7];
+    inv[1] = m[2] * m[7] - m[1] * m[8];
+    inv[2] = m[1] * m[5] - m[2] * m[4];
+    inv[3] = m[5] * m[6] - m[3] * m[8];
+    inv[4] = m[0] * m[8] - m[2] * m[6];
+    inv[5] = m[2] * m[3] - m[0] * m[5];
+    inv[6] = m[3] * m[7] - m[4] * m[6];
+    inv[7] = m[1] * m[6] - m[0] * m[7];
+    inv[8] = m[0] * m[4] - m[1] * m[3];
+    const double det = m[0] * inv[0] + m[1] * inv[3] + m[2] * inv[6];
+    for (int k = 0; k < 9; ++k)
+    {
+      inv[k] /= det;
+    }
+    return shift;
+  }
+
+  void toWGS84(const DatumShift &shift,
+               const double *lat, const double *lon, const double *alt,
+               size_t count,
+               double *lat_out, double *lon_out, double *alt_out)
+  {
+    shiftPoints(shift.t, shift.m, shift.a, shift.e2,
+                WGS84_ELLIPSOID.a, eccentricity2(WGS84_ELLIPSOID.inverse_f),
+                lat, lon, alt, count, lat_out, lon_out, alt_out);
+  }
+
+  void fromWGS84(const DatumShift &shift,
+                 const double *lat, const double *lon, const double *alt,
+                 size_t count,
+                 double *lat_out, double *lon_out, double *alt_out)
+  {
+    // X = m^-1 (X' - t) = m^-1 X' + t'
+    const double *inv = shift.m_inverse;
+    const double t[3] =
+    {
+      -(inv[0] * shift.t[0] + inv[1] * shift.t[1] + inv[2] * shift.t[2]),
+      -(inv[3] * shift.t[0] + inv[4] * shift.t[1] + inv[5] * shift.t[2]),
+      -(inv[6] * shift.t[0] + inv[7] * shift.t[1] + inv[8] * shift.t[2])
+    };
+    shiftPoints(t, inv,
+                WGS84_ELLIPSOID.a, eccentricity2(WGS84_ELLIPSOID.inverse_f),
+                shift.a, shift.e2,
+                lat, lon, alt, count, lat_out, lon_out, alt_out);
+  }
+
+  void toUTM(const DatumShift &shift, const double *lat, const double *lon,
+             size_t count, int zone, bool north,
+             double *northing, double *easting)
+  {
+    double wgs_lat[BLOCK_SIZE];
+    double wgs_lon[BLOCK_SIZE];
+    for (size_t b = 0; b < count; b += BLOCK_SIZE)
+    {
+      const size_t n = std::min(BLOCK_SIZE, count - b);
+      toWGS84(shift, lat + b, lon + b, NULL, n, wgs_lat, wgs_lon, NULL);
+      GeonavBatch::LLtoUTM(wgs_lat, wgs_lon, n, zone, north,
+                           northing + b, easting + b);
+    }
+  }
+
+  void toLocal(const DatumShift &shift, const GeonavBatch::Datum &datum,
+               const double *lat, const double *lon, size_t count,
+               double *x, double *y)
+  {
+    double wgs_lat[BLOCK_SIZE];
+    double wgs_lon[BLOCK_SIZE];
+    for (size_t b = 0; b < count; b += BLOCK_SIZE)
+    {
+      const size_t n = std::min(BLOCK_SIZE, count - b);
+      toWGS84(shift, lat + b, lon + b, NULL, n, wgs_lat, wgs_lon, NULL);
+      GeonavBatch::LLtoLocal(datum, wgs_lat, wgs_lon, n, x + b, y + b);
+    }
+  }
+
+}  // namespace GeonavHelmert
+}  // namespace GeonavTransform
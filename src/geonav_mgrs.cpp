@@ -0,0 +1,323 @@
+/*
+
+Copyright (c) 2017, Brian Bingham
+All rights reserved
+
+This file is part of the geonav_transform package.
+
+Geonav_transform is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Geonav_transform is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this package.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "geonav_transform/geonav_mgrs.h"
+#include "geonav_transform/geonav_batch.h"
+#include "geonav_transform/navsat_conversions.h"
+
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+namespace GeonavTransform
+{
+namespace GeonavMgrs
+{
+  namespace
+  {
+    const size_t BLOCK_SIZE = 256;
+    const double GRID = NavsatConversions::grid_size;
+    //! @brief Period of the row letters [m]
+    const double ROW_PERIOD = 20 * GRID;
+
+    //! @brief Latitude bands, 8 degrees from 80S (X is 12)
+    const char BANDS[] = "CDEFGHJKLMNPQRSTUVWX";
+    //! @brief Column letters of zones 1, 2, 3 (mod 3) and row letters,
+    //! I and O omitted
+    const char *const COLUMNS[] = {"STUVWXYZ", "ABCDEFGH", "JKLMNPQR"};
+    const char ROWS[] = "ABCDEFGHJKLMNPQRSTUV";
+
+    const double POW10[] = {1.0, 10.0, 100.0, 1000.0, 10000.0, 100000.0};
+
+    int indexOf(const char *letters, char c)
+    {
+      const char *p = (c != 0) ? std::strchr(letters, c) : NULL;
+      return p ? static_cast<int>(p - letters) : -1;
+    }
+
+    //! @brief Northing of the centre of each band on a central meridian,
+    //! to pick the 2000 km row cycle when decoding
+    struct BandNorthings
+    {
+      BandNorthings()
+      {
+        for (int b = 0; b < 20; ++b)
+        {
+          double lat = (b == 19) ? 78.0 : -76.0 + 8.0 * b;
+          double lon = 3.0;
+          double easting;
+          GeonavBatch::LLtoUTM(&lat, &lon, 1, 31, lat >= 0,
+                               &northing[b], &easting);
+        }
+      }
+      double northing[20];
+    };
+
+    const BandNorthings &bandNorthings()
+    {
+      static const BandNorthings table;
+      return table;
+    }
+
+    void writeDigits(char *out, long value, int digits)
+    {
+      for (int d = digits - 1; d >= 0; --d)
+      {
+        out[d] = static_cast<char>('0' + value % 10);
+        value /= 10;
+      }
+    }
+
+    //! @brief Format one point already projected in its zone
+    //! @return false if the point is outside the UTM grid
+    bool format(int zone, char band, double northing, double easting,
+                int precision, char *out)
+    {
+      const double column = std::floor(easting / GRID);
+      const double row = std::floor(northing / GRID);
+      if (!(column >= 1 && column <= 8 && row >= 0 && row < 100))
+      {
+        return false;
+      }
+      int row_index = static_cast<int>(row) % 20;
+      if (zone % 2 == 0)
+      {
+        row_index = (row_index + 5) % 20;
+      }
+      const double scale = POW10[5 - precision];
+      out[0] = static_cast<char>('0' + zone / 10);
+      out[1] = static_cast<char>('0' + zone % 10);
+      out[2] = band;
+      out[3] = COLUMNS[zone % 3][static_cast<int>(column) - 1];
+      out[4] = ROWS[row_index];
+      // Truncated, not rounded
+      writeDigits(out + 5,
+                  static_cast<long>((easting - column * GRID) / scale),
+                  precision);
+      writeDigits(out + 5 + precision,
+                  static_cast<long>((northing - row * GRID) / scale),
+                  precision);
+      out[5 + 2 * precision] = 0;
+      return true;
+    }
+
+    //! @brief Parse one record
+    //! @return false if it isn't a valid MGRS reference
+    bool parse(const char *in, size_t stride, bool centre,
+               int &zone, bool &north, double &northing, double &easting)
+    {
+      // Upper case, without spaces
+      char s[24];
+      size_t n = 0;
+      for (size_t i = 0; i < stride && in[i] != 0; ++i)
+      {
+        char c = in[i];
+        if (c == ' ')
+        {
+          continue;
+        }
+        if (n == sizeof(s) - 1)
+        {
+          return false;
+        }
+        s[n++] = (c >= 'a' && c <= 'z') ? static_cast<char>(c - 'a' + 'A') : c;
+      }
+      s[n] = 0;
+
+      size_t k = 0;
+      zone = 0;
+      while (k < 2 && s[k] >= '0' && s[k] <= '9')
+      {
+        zone = 10 * zone + (s[k++] - '0');
+      }
+      if (k == 0 || zone < 1 || zone > 60)
+      {
+        return false;
+      }
+      const int band = indexOf(BANDS, s[k]);
+      const int column = indexOf(COLUMNS[zone % 3], s[k + 1 < n ? k + 1 : n]);
+      int row = indexOf(ROWS, s[k + 2 < n ? k + 2 : n]);
+      if (band < 0 || column < 0 || row < 0)
+      {
+        return false;
+      }
+      k += 3;
+
+      const size_t digits = n - k;
+      if (digits % 2 != 0 || digits > 10)
+      {
+        return false;
+      }
+      const int precision = static_cast<int>(digits / 2);
+      double e = 0.0;
+      double m = 0.0;
+      for (int d = 0; d < precision; ++d)
+      {
+        const char ce = s[k + d];
+        const char cn = s[k + precision + d];
+        if (ce < '0' || ce > '9' || cn < '0' || cn > '9')
+        {
+          return false;
+        }
+        e = 10 * e + (ce - '0');
+        m = 10 * m + (cn - '0');
+      }
+      const double scale = POW10[5 - precision];
+      const double offset = centre ? 0.5 * scale : 0.0;
+
+      if (zone % 2 == 0)
+      {
+        row = (row + 15) % 20;
+      }
+      easting = (column + 1) * GRID + e * scale + offset;
+      northing = row * GRID + m * scale + offset;
+      // The row letters repeat every 2000 km; take the cycle nearest to
+      // the band, which is less than 1000 km from any of its squares
+      const double band_northing = bandNorthings().northing[band];
+      northing += ROW_PERIOD * std::floor((band_northing - northing) / ROW_PERIOD + 0.5);
+      north = (BANDS[band] >= 'N');
+      return true;
+    }
+  }  // namespace
+
+  size_t encode(const double *lat, const double *lon, size_t count,
+                int precision, char *out, size_t stride)
+  {
+    if (precision < 0 || precision > 5 || stride < encodedSize(precision))
+    {
+      return 0;
+    }
+    int zone[BLOCK_SIZE];
+    char band[BLOCK_SIZE];
+    double northing[BLOCK_SIZE];
+    double easting[BLOCK_SIZE];
+    size_t encoded = 0;
+    for (size_t b = 0; b < count; b += BLOCK_SIZE)
+    {
+      const size_t n = std::min(BLOCK_SIZE, count - b);
+      for (size_t i = 0; i < n; ++i)
+      {
+        if (std::isfinite(lat[b + i]) && std::isfinite(lon[b + i]))
+        {
+          GeonavBatch::UTMZones(&lat[b + i], &lon[b + i], 1, &zone[i], &band[i]);
+        }
+        else
+        {
+          band[i] = 'Z';
+        }
+        if (band[i] == 'Z')
+        {
+          zone[i] = 0;
+        }
+      }
+      // Project runs of points in the same zone and hemisphere together
+      size_t i = 0;
+      while (i < n)
+      {
+        const bool north = !(lat[b + i] < 0);
+        size_t j = i + 1;
+        while (j < n && zone[j] == zone[i] && !(lat[b + j] < 0) == north)
+        {
+          ++j;
+        }
+        if (zone[i] != 0)
+        {
+          GeonavBatch::LLtoUTM(lat + b + i, lon + b + i, j - i, zone[i], north,
+                               northing + i, easting + i);
+        }
+        i = j;
+      }
+      for (i = 0; i < n; ++i)
+      {
+        char *record = out + (b + i) * stride;
+        if (zone[i] != 0 &&
+            format(zone[i], band[i], northing[i], easting[i], precision, record))
+        {
+          ++encoded;
+        }
+        else
+        {
+          record[0] = 0;
+        }
+      }
+    }
+    return encoded;
+  }
+
+  size_t decodeUTM(const char *in, size_t count, size_t stride, bool centre,
+                   int *zone, unsigned char *north,
+                   double *northing, double *easting)
+  {
+    size_t decoded = 0;
+    for (size_t i = 0; i < count; ++i)
+    {
+      bool is_north = false;
+      if (parse(in + i * stride, stride, centre, zone[i], is_north,
+                northing[i], easting[i]))
+      {
+        north[i] = is_north;
+        ++decoded;
+      }
+      else
+      {
+        zone[i] = 0;
+        north[i] = 0;
+        northing[i] = std::numeric_limits<double>::quiet_NaN();
+        easting[i] = std::numeric_limits<double>::quiet_NaN();
+      }
+    }
+    return decoded;
+  }
+
+  size_t decode(const char *in, size_t count, size_t stride, bool centre,
+                double *lat, double *lon)
+  {
+    int zone[BLOCK_SIZE];
+    unsigned char north[BLOCK_SIZE];
+    size_t decoded = 0;
+    for (size_t b = 0; b < count; b += BLOCK_SIZE)
+    {
+      const size_t n = std::min(BLOCK_SIZE, count - b);
+      // UTM into the outputs, then converted in place
+      decoded += decodeUTM(in + b * stride, n, stride, centre,
+                           zone, north, lat + b, lon + b);
+      size_t i = 0;
+      while (i < n)
+      {
+        size_t j = i + 1;
+        while (j < n && zone[j] == zone[i] && north[j] == north[i])
+        {
+          ++j;
+        }
+        if (zone[i] != 0)
+        {
+          GeonavBatch::UTMtoLL(lat + b + i, lon + b + i, j - i, zone[i],
+                               north[i], lat + b + i, lon + b + i);
+        }
+        i = j;
+      }
+    }
+    return decoded;
+  }
+
+}  // namespace GeonavMgrs
+}  // namespace GeonavTransform
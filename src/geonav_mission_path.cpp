@@ -0,0 +1,158 @@
+/*
+
+Copyright (c) 2017, Brian Bingham
+All rights reserved
+
+This file is part of the geonav_transform package.
+
+Geonav_transform is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Geonav_transform is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this package.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "geonav_transform/geonav_mission_path.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace GeonavTransform
+{
+
+MissionPath::MissionPath(double reacquire_distance) :
+  reacquire_distance_(reacquire_distance),
+  cursor_(0),
+  have_cursor_(false)
+{
+}
+
+void MissionPath::setPath(const double *x, const double *y, size_t count)
+{
+  legs_.clear();
+  reset();
+  double start = 0.0;
+  size_t from = 0;
+  for (size_t to = 1; to < count; ++to)
+  {
+    const double dx = x[to] - x[from];
+    const double dy = y[to] - y[from];
+    const double length = std::sqrt(dx*dx + dy*dy);
+    if (length <= 0.0)
+    {
+      continue;
+    }
+    Leg leg = {x[from], y[from], dx / length, dy / length, length, start, to};
+    legs_.push_back(leg);
+    start += length;
+    from = to;
+  }
+}
+
+void MissionPath::setPath(const GeonavBatch::Datum &datum,
+                          const double *lat, const double *lon, size_t count)
+{
+  std::vector<double> x(count);
+  std::vector<double> y(count);
+  GeonavBatch::LLtoLocal(datum, lat, lon, count, x.data(), y.data());
+  setPath(x.data(), y.data(), count);
+}
+
+void MissionPath::reset()
+{
+  cursor_ = 0;
+  have_cursor_ = false;
+}
+
+size_t MissionPath::legs() const
+{
+  return legs_.size();
+}
+
+double MissionPath::alongLeg(size_t i, double x, double y) const
+{
+  const Leg &leg = legs_[i];
+  return (x - leg.x) * leg.ux + (y - leg.y) * leg.uy;
+}
+
+double MissionPath::distance2(size_t i, double x, double y) const
+{
+  const Leg &leg = legs_[i];
+  const double t = std::min(leg.length, std::max(0.0, alongLeg(i, x, y)));
+  const double ex = leg.x + t * leg.ux - x;
+  const double ey = leg.y + t * leg.uy - y;
+  return ex*ex + ey*ey;
+}
+
+bool MissionPath::track(double x, double y, Result &result)
+{
+  if (legs_.empty())
+  {
+    return false;
+  }
+
+  if (have_cursor_ &&
+      distance2(cursor_, x, y) > reacquire_distance_ * reacquire_distance_)
+  {
+    have_cursor_ = false;
+  }
+  if (!have_cursor_)
+  {
+    // (Re)acquire - nearest leg over the whole path
+    double best = distance2(0, x, y);
+    cursor_ = 0;
+    for (size_t i = 1; i < legs_.size(); ++i)
+    {
+      const double d2 = distance2(i, x, y);
+      if (d2 < best)
+      {
+        best = d2;
+        cursor_ = i;
+      }
+    }
+    have_cursor_ = true;
+  }
+  else
+  {
+    // Move on once past the end of the leg, back if behind its start
+    // and the previous leg is closer
+    while (cursor_ + 1 < legs_.size() &&
+           alongLeg(cursor_, x, y) > legs_[cursor_].length)
+    {
+      ++cursor_;
+    }
+    while (cursor_ > 0 && alongLeg(cursor_, x, y) < 0.0 &&
+           distance2(cursor_ - 1, x, y) < distance2(cursor_, x, y))
+    {
+      --cursor_;
+    }
+  }
+
+  const Leg &leg = legs_[cursor_];
+  const Leg &last = legs_.back();
+  const double along = alongLeg(cursor_, x, y);
+  const double total = last.start + last.length;
+  const double end_x = leg.x + leg.length * leg.ux;
+  const double end_y = leg.y + leg.length * leg.uy;
+
+  result.leg = cursor_;
+  result.cross_track = leg.ux * (y - leg.y) - leg.uy * (x - leg.x);
+  result.along_track = leg.start + along;
+  result.remaining = total - result.along_track;
+  result.next_waypoint = leg.waypoint;
+  result.next_waypoint_distance = std::sqrt((end_x - x)*(end_x - x) +
+                                            (end_y - y)*(end_y - y));
+  result.leg_heading = std::atan2(leg.uy, leg.ux);
+  result.complete = (cursor_ + 1 == legs_.size() && along > leg.length);
+  return true;
+}
+
+}  // namespace GeonavTransform
@@ -0,0 +1,152 @@
+/*
+
+Copyright (c) 2017, Brian Bingham
+All rights reserved
+
+This file is part of the geonav_transform package.
+
+Geonav_transform is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Geonav_transform is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this package.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "geonav_transform/geonav_pose_history.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace GeonavTransform
+{
+
+PoseHistory::PoseHistory(size_t capacity) :
+  samples_(std::max<size_t>(capacity, 2)),
+  head_(0),
+  count_(0)
+{
+}
+
+bool PoseHistory::push(const Sample &sample)
+{
+  if (count_ > 0 && !(sample.stamp > latest().stamp))
+  {
+    return false;
+  }
+  if (count_ < samples_.size())
+  {
+    samples_[(head_ + count_) % samples_.size()] = sample;
+    ++count_;
+  }
+  else
+  {
+    // Full - overwrite the oldest
+    samples_[head_] = sample;
+    head_ = (head_ + 1) % samples_.size();
+  }
+  return true;
+}
+
+bool PoseHistory::interpolate(double stamp, double max_gap, Sample &pose) const
+{
+  if (count_ == 0 || stamp < at(0).stamp)
+  {
+    return false;
+  }
+  const Sample &last = latest();
+  if (stamp >= last.stamp)
+  {
+    if (stamp - last.stamp > max_gap)
+    {
+      return false;
+    }
+    pose = last;
+    pose.stamp = stamp;
+    return true;
+  }
+
+  // First sample after stamp, by bisection over the ring
+  size_t lo = 0;
+  size_t hi = count_ - 1;
+  while (hi - lo > 1)
+  {
+    size_t mid = (lo + hi) / 2;
+    if (at(mid).stamp > stamp)
+    {
+      hi = mid;
+    }
+    else
+    {
+      lo = mid;
+    }
+  }
+  const Sample &a = at(lo);
+  const Sample &b = at(hi);
+  if (b.stamp - a.stamp > max_gap)
+  {
+    return false;
+  }
+
+  const double t = (stamp - a.stamp) / (b.stamp - a.stamp);
+  pose.stamp = stamp;
+  pose.x = a.x + t * (b.x - a.x);
+  pose.y = a.y + t * (b.y - a.y);
+  pose.z = a.z + t * (b.z - a.z);
+
+  // Slerp along the shorter arc
+  double dot = a.qx*b.qx + a.qy*b.qy + a.qz*b.qz + a.qw*b.qw;
+  const double sign = (dot < 0.0) ? -1.0 : 1.0;
+  dot *= sign;
+  double wa = 1.0 - t;
+  double wb = t * sign;
+  if (dot < 0.9995)
+  {
+    const double theta = std::acos(dot);
+    const double s = std::sin(theta);
+    wa = std::sin((1.0 - t) * theta) / s;
+    wb = sign * std::sin(t * theta) / s;
+  }
+  pose.qx = wa * a.qx + wb * b.qx;
+  pose.qy = wa * a.qy + wb * b.qy;
+  pose.qz = wa * a.qz + wb * b.qz;
+  pose.qw = wa * a.qw + wb * b.qw;
+  // Renormalize, needed after the nearly parallel (lerp) case
+  const double norm = std::sqrt(pose.qx*pose.qx + pose.qy*pose.qy +
+                                pose.qz*pose.qz + pose.qw*pose.qw);
+  pose.qx /= norm;
+  pose.qy /= norm;
+  pose.qz /= norm;
+  pose.qw /= norm;
+  return true;
+}
+
+size_t PoseHistory::size() const
+{
+  return count_;
+}
+
+const PoseHistory::Sample &PoseHistory::latest() const
+{
+  return at(count_ - 1);
+}
+
+void PoseHistory::clear()
+{
+  head_ = 0;
+  count_ = 0;
+}
+
+const PoseHistory::Sample &PoseHistory::at(size_t i) const
+{
+  return samples_[(head_ + i) % samples_.size()];
+}
+
+}  // namespace GeonavTransform
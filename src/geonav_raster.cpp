@@ -0,0 +1,287 @@
+/*
+
+Copyright (c) 2017, Brian Bingham
+All rights reserved
+
+This file is part of the geonav_transform package.
+
+Geonav_transform is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Geonav_transform is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this package.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "geonav_transform/geonav_raster.h"
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <vector>
+
+namespace GeonavTransform
+{
+namespace GeonavRaster
+{
+  namespace
+  {
+    const float MISSING = std::numeric_limits<float>::quiet_NaN();
+
+    //! @brief Source pixel coordinates (u along the rows, v down the
+    //! columns, 0 at the first pixel's centre) at every spacing-th cell
+    struct ControlGrid
+    {
+      size_t spacing;
+      size_t nx;
+      size_t ny;
+      std::vector<double> u;
+      std::vector<double> v;
+    };
+
+    void buildControlGrid(const GeonavBatch::Datum &datum,
+                          const GeoRaster &raster, const LocalGrid &grid,
+                          size_t spacing, ControlGrid &control)
+    {
+      control.spacing = std::max<size_t>(spacing, 1);
+      // One past the last cell, so every cell has control points on both
+      // sides
+      control.nx = (grid.width > 0 ? (grid.width - 1) / control.spacing : 0) + 2;
+      control.ny = (grid.height > 0 ? (grid.height - 1) / control.spacing : 0) + 2;
+      const size_t count = control.nx * control.ny;
+      control.u.resize(count);
+      control.v.resize(count);
+
+      // Cell centres in the local frame, converted in place to lon/lat
+      for (size_t k = 0; k < control.ny; ++k)
+      {
+        for (size_t c = 0; c < control.nx; ++c)
+        {
+          control.u[k * control.nx + c] =
+            grid.origin_x + (c * control.spacing + 0.5) * grid.resolution;
+          control.v[k * control.nx + c] =
+            grid.origin_y + (k * control.spacing + 0.5) * grid.resolution;
+        }
+      }
+      double *lon = control.u.data();
+      double *lat = control.v.data();
+      GeonavBatch::LocalToLL(datum, lon, lat, count, lat, lon);
+
+      // Longitudes are taken within 180 degrees of the raster's centre, so
+      // rasters across the antimeridian stay continuous
+      const double half_span = 0.5 * raster.width * raster.cell_lon;
+      for (size_t i = 0; i < count; ++i)
+      {
+        double dlon = std::remainder(lon[i] - raster.west - half_span, 360.0)
+          + half_span;
+        lon[i] = dlon / raster.cell_lon - 0.5;
+        lat[i] = (raster.north - lat[i]) / raster.cell_lat - 0.5;
+      }
+    }
+
+    bool missing(const GeoRaster &raster, float value)
+    {
+      return std::isnan(value) || value == raster.nodata;
+    }
+
+    float nearest(const GeoRaster &raster, double u, double v)
+    {
+      size_t iu = std::min(static_cast<size_t>(u + 0.5), raster.width - 1);
+      size_t iv = std::min(static_cast<size_t>(v + 0.5), raster.height - 1);
+      float value = raster.data[iv * raster.width + iu];
+      return missing(raster, value) ? MISSING : value;
+    }
+
+    float sample(const GeoRaster &raster, double u, double v,
+                 Interpolation interpolation)
+    {
+      // Written so NaN coordinates fall outside
+      if (!(u >= -0.5 && u <= raster.width - 0.5 &&
+            v >= -0.5 && v <= raster.height - 0.5))
+      {
+        return MISSING;
+      }
+      if (interpolation == INTERPOLATE_NEAREST ||
+          raster.width < 2 || raster.height < 2)
+      {
+        return nearest(raster, u, v);
+      }
+
+      // Clamped to the outer pixel centres at the edges
+      const double uc = std::min(std::max(u, 0.0), raster.width - 1.0);
+      const double vc = std::min(std::max(v, 0.0), raster.height - 1.0);
+      const size_t iu = std::min(static_cast<size_t>(uc), raster.width - 2);
+      const size_t iv = std::min(static_cast<size_t>(vc), raster.height - 2);
+      const float fu = static_cast<float>(uc - iu);
+      const float fv = static_cast<float>(vc - iv);
+      const float *p = raster.data + iv * raster.width + iu;
+      const float a = p[0];
+      const float b = p[1];
+      const float c = p[raster.width];
+      const float d = p[raster.width + 1];
+      if (missing(raster, a) || missing(raster, b) ||
+          missing(raster, c) || missing(raster, d))
+      {
+        return nearest(raster, u, v);
+      }
+      const float top = a + fu * (b - a);
+      const float bottom = c + fu * (d - c);
+      return top + fv * (bottom - top);
+    }
+
+    //! @brief Sample the cells [x0, x1) x [y0, y1) of the grid
+    void reprojectTile(const GeoRaster &raster, const LocalGrid &grid,
+                       const ControlGrid &control, Interpolation interpolation,
+                       size_t x0, size_t x1, size_t y0, size_t y1, float *out)
+    {
+      const size_t s = control.spacing;
+      const double inv = 1.0 / s;
+      for (size_t j = y0; j < y1; ++j)
+      {
+        // Source coordinates of this row at the control columns are
+        // interpolated between control rows k and k + 1
+        const size_t k = j / s;
+        const double fy = (j - k * s) * inv;
+        const double *u0 = &control.u[k * control.nx];
+        const double *u1 = u0 + control.nx;
+        const double *v0 = &control.v[k * control.nx];
+        const double *v1 = v0 + control.nx;
+        float *row = out + j * grid.width;
+
+        size_t i = x0;
+        while (i < x1)
+        {
+          // Then linearly, by increments, between control columns
+          const size_t c = i / s;
+          const size_t end = std::min(x1, (c + 1) * s);
+          const double ua = u0[c] + fy * (u1[c] - u0[c]);
+          const double ub = u0[c + 1] + fy * (u1[c + 1] - u0[c + 1]);
+          const double va = v0[c] + fy * (v1[c] - v0[c]);
+          const double vb = v0[c + 1] + fy * (v1[c + 1] - v0[c + 1]);
+          const double du = (ub - ua) * inv;
+          const double dv = (vb - va) * inv;
+          double u = ua + (i - c * s) * du;
+          double v = va + (i - c * s) * dv;
+          for (; i < end; ++i, u += du, v += dv)
+          {
+            row[i] = sample(raster, u, v, interpolation);
+          }
+        }
+      }
+    }
+
+    //! @brief Tile t of the grid, numbered row by row
+    void reprojectTiles(const GeoRaster &raster, const LocalGrid &grid,
+                        const ControlGrid &control, const ReprojectOptions &options,
+                        size_t begin, size_t end, float *out)
+    {
+      const size_t tile = std::max<size_t>(options.tile_size, 1);
+      const size_t tiles_x = (grid.width + tile - 1) / tile;
+      for (size_t t = begin; t < end; ++t)
+      {
+        const size_t x0 = (t % tiles_x) * tile;
+        const size_t y0 = (t / tiles_x) * tile;
+        reprojectTile(raster, grid, control, options.interpolation,
+                      x0, std::min(grid.width, x0 + tile),
+                      y0, std::min(grid.height, y0 + tile), out);
+      }
+    }
+
+    //! @brief Nothing to sample: fill out with NaN if the raster is empty
+    //! (width - 1 would wrap in nearest()), skip an empty grid
+    bool emptyInput(const GeoRaster &raster, const LocalGrid &grid, float *out)
+    {
+      if (grid.width == 0 || grid.height == 0)
+      {
+        return true;
+      }
+      if (raster.width == 0 || raster.height == 0 || raster.data == NULL)
+      {
+        std::fill(out, out + grid.width * grid.height, MISSING);
+        return true;
+      }
+      return false;
+    }
+
+    size_t tileCount(const LocalGrid &grid, const ReprojectOptions &options)
+    {
+      const size_t tile = std::max<size_t>(options.tile_size, 1);
+      return ((grid.width + tile - 1) / tile) * ((grid.height + tile - 1) / tile);
+    }
+  }  // namespace
+
+  void reproject(const GeonavBatch::Datum &datum, const GeoRaster &raster,
+                 const LocalGrid &grid, float *out,
+                 const ReprojectOptions &options)
+  {
+    if (emptyInput(raster, grid, out))
+    {
+      return;
+    }
+    ControlGrid control;
+    buildControlGrid(datum, raster, grid, options.control_spacing, control);
+    reprojectTiles(raster, grid, control, options,
+                   0, tileCount(grid, options), out);
+  }
+
+  void reprojectAsync(const GeonavBatch::Datum &datum, const GeoRaster &raster,
+                      const LocalGrid &grid, float *out,
+                      const ReprojectOptions &options,
+                      const GeonavBatch::BatchCallback &done,
+                      const GeonavBatch::BatchOptions &batch)
+  {
+    if (emptyInput(raster, grid, out))
+    {
+      // Still completes on the pool, with no tiles sampled
+      GeonavBatch::runChunked(0, [](size_t, size_t) {}, done, batch);
+      return;
+    }
+    // The control grid is small; build it here and share it with the tiles
+    std::shared_ptr<ControlGrid> control = std::make_shared<ControlGrid>();
+    buildControlGrid(datum, raster, grid, options.control_spacing, *control);
+
+    const size_t tile = std::max<size_t>(options.tile_size, 1);
+    GeonavBatch::BatchOptions tile_batch = batch;
+    tile_batch.chunk_size = std::max<size_t>(batch.chunk_size / (tile * tile), 1);
+    GeonavBatch::runChunked(tileCount(grid, options), [=](size_t b, size_t e)
+    {
+      reprojectTiles(raster, grid, *control, options, b, e, out);
+    }, done, tile_batch);
+  }
+
+  std::future<size_t> reprojectAsync(const GeonavBatch::Datum &datum,
+                                     const GeoRaster &raster,
+                                     const LocalGrid &grid, float *out,
+                                     const ReprojectOptions &options,
+                                     const GeonavBatch::BatchOptions &batch)
+  {
+    std::shared_ptr<std::promise<size_t> > promise =
+      std::make_shared<std::promise<size_t> >();
+    std::future<size_t> future = promise->get_future();
+    reprojectAsync(datum, raster, grid, out, options,
+                   [promise](size_t tiles) { promise->set_value(tiles); },
+                   batch);
+    return future;
+  }
+
+  void toOccupancy(const float *values, size_t count,
+                   float free_value, float occupied_value, int8_t *out)
+  {
+    const float scale = 100.0f / (occupied_value - free_value);
+    for (size_t i = 0; i < count; ++i)
+    {
+      const float occupancy = (values[i] - free_value) * scale;
+      out[i] = std::isnan(occupancy) ? -1 : static_cast<int8_t>(
+        std::min(std::max(occupancy, 0.0f), 100.0f) + 0.5f);
+    }
+  }
+
+}  // namespace GeonavRaster
+}  // namespace GeonavTransform
@@ -0,0 +1,181 @@
+/*
+
+Copyright (c) 2017, Brian Bingham
+All rights reserved
+
+This file is part of the geonav_transform package.
+
+Geonav_transform is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Geonav_transform is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this package.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "geonav_transform/geonav_sounding.h"
+
+#include <cmath>
+#include <limits>
+
+namespace GeonavTransform
+{
+
+namespace
+{
+  //! @brief Row-major rotation matrix of a unit quaternion
+  void quaternionToMatrix(double qx, double qy, double qz, double qw,
+                          double *m)
+  {
+    m[0] = 1 - 2*(qy*qy + qz*qz);
+    m[1] = 2*(qx*qy - qz*qw);
+    m[2] = 2*(qx*qz + qy*qw);
+    m[3] = 2*(qx*qy + qz*qw);
+    m[4] = 1 - 2*(qx*qx + qz*qz);
+    m[5] = 2*(qy*qz - qx*qw);
+    m[6] = 2*(qx*qz - qy*qw);
+    m[7] = 2*(qy*qz + qx*qw);
+    m[8] = 1 - 2*(qx*qx + qy*qy);
+  }
+}  // namespace
+
+SoundingGeoreferencer::SoundingGeoreferencer(size_t history_size) :
+  datum_(GeonavBatch::makeDatum(0.0, 0.0, 0.0)),
+  history_(history_size),
+  max_gap_(1.0)
+{
+  setMount(0.0, 0.0, 0.0, 0.0, 0.0, 0.0);
+}
+
+void SoundingGeoreferencer::setDatum(const GeonavBatch::Datum &datum)
+{
+  datum_ = datum;
+  history_.clear();
+}
+
+void SoundingGeoreferencer::setMount(double x, double y, double z,
+                                     double roll, double pitch, double yaw)
+{
+  lever_arm_[0] = x;
+  lever_arm_[1] = y;
+  lever_arm_[2] = z;
+  // Fixed axis roll, pitch, yaw, as tf2::Quaternion::setRPY
+  const double cr = std::cos(roll), sr = std::sin(roll);
+  const double cp = std::cos(pitch), sp = std::sin(pitch);
+  const double cy = std::cos(yaw), sy = std::sin(yaw);
+  mount_[0] = cy*cp;
+  mount_[1] = cy*sp*sr - sy*cr;
+  mount_[2] = cy*sp*cr + sy*sr;
+  mount_[3] = sy*cp;
+  mount_[4] = sy*sp*sr + cy*cr;
+  mount_[5] = sy*sp*cr - cy*sr;
+  mount_[6] = -sp;
+  mount_[7] = cp*sr;
+  mount_[8] = cp*cr;
+}
+
+void SoundingGeoreferencer::setMaxGap(double max_gap)
+{
+  max_gap_ = max_gap;
+}
+
+bool SoundingGeoreferencer::addPose(const PoseHistory::Sample &pose)
+{
+  return history_.push(pose);
+}
+
+const PoseHistory &SoundingGeoreferencer::history() const
+{
+  return history_;
+}
+
+size_t SoundingGeoreferencer::georeference(const Ping &ping,
+                                           const Soundings &out) const
+{
+  const size_t n = ping.count;
+  scratch_.resize(3 * n);
+  double *bx = scratch_.data();
+  double *by = bx + n;
+  double *bz = by + n;
+
+  // Beam vectors in base_link: lever arm + mount * range * direction
+  const double *m = mount_;
+  for (size_t i = 0; i < n; ++i)
+  {
+    const double r = ping.range[i];
+    const double ac = ping.across[i];
+    const double al = ping.along ? ping.along[i] : 0.0;
+    const double ca = std::cos(al);
+    const double sx = r * std::sin(al);
+    const double sy = r * ca * std::sin(ac);
+    const double sz = -r * ca * std::cos(ac);
+    bx[i] = lever_arm_[0] + m[0]*sx + m[1]*sy + m[2]*sz;
+    by[i] = lever_arm_[1] + m[3]*sx + m[4]*sy + m[5]*sz;
+    bz[i] = lever_arm_[2] + m[6]*sx + m[7]*sy + m[8]*sz;
+  }
+
+  // Into the local frame with the vehicle pose, interpolated once per run
+  // of beams sharing a time
+  const double nan = std::numeric_limits<double>::quiet_NaN();
+  size_t referenced = 0;
+  size_t i = 0;
+  while (i < n)
+  {
+    const size_t begin = i;
+    const float offset = ping.time_offset ? ping.time_offset[i] : 0.0f;
+    size_t end = i + 1;
+    if (ping.time_offset)
+    {
+      while (end < n && ping.time_offset[end] == offset)
+      {
+        ++end;
+      }
+    }
+    else
+    {
+      end = n;
+    }
+
+    PoseHistory::Sample pose;
+    if (!history_.interpolate(ping.stamp + offset, max_gap_, pose))
+    {
+      for (; i < end; ++i)
+      {
+        out.x[i] = out.y[i] = out.z[i] = nan;
+      }
+      continue;
+    }
+    double R[9];
+    quaternionToMatrix(pose.qx, pose.qy, pose.qz, pose.qw, R);
+    for (; i < end; ++i)
+    {
+      out.x[i] = pose.x + R[0]*bx[i] + R[1]*by[i] + R[2]*bz[i];
+      out.y[i] = pose.y + R[3]*bx[i] + R[4]*by[i] + R[5]*bz[i];
+      out.z[i] = pose.z + R[6]*bx[i] + R[7]*by[i] + R[8]*bz[i];
+    }
+    referenced += end - begin;
+  }
+
+  if (out.latitude && out.longitude)
+  {
+    GeonavBatch::LocalToLL(datum_, out.x, out.y, n,
+                           out.latitude, out.longitude);
+  }
+  if (out.altitude)
+  {
+    for (size_t j = 0; j < n; ++j)
+    {
+      out.altitude[j] = out.z[j] + datum_.altitude;
+    }
+  }
+  return referenced;
+}
+
+}  // namespace GeonavTransform
@@ -0,0 +1,157 @@
+/*
+
+Copyright (c) 2017, Brian Bingham
+All rights reserved
+
+This file is part of the geonav_transform package.
+
+Geonav_transform is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Geonav_transform is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this package.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "geonav_transform/geonav_thread_pool.h"
+
+namespace GeonavTransform
+{
+
+namespace
+{
+  // Pool and queue index of the calling thread, if it is a worker
+  thread_local const ThreadPool *tl_pool = NULL;
+  thread_local size_t tl_index = 0;
+
+  std::atomic<size_t> shared_concurrency(0);
+}  // namespace
+
+ThreadPool::ThreadPool(size_t num_threads) :
+  pending_(0),
+  next_worker_(0),
+  stop_(false)
+{
+  if (num_threads == 0)
+  {
+    num_threads = std::thread::hardware_concurrency();
+  }
+  if (num_threads == 0)
+  {
+    num_threads = 1;
+  }
+
+  for (size_t i = 0; i < num_threads; ++i)
+  {
+    workers_.push_back(std::unique_ptr<Worker>(new Worker));
+  }
+  for (size_t i = 0; i < num_threads; ++i)
+  {
+    threads_.push_back(std::thread(&ThreadPool::workerLoop, this, i));
+  }
+}
+
+ThreadPool::~ThreadPool()
+{
+  {
+    std::lock_guard<std::mutex> lock(wake_mutex_);
+    stop_ = true;
+  }
+  wake_.notify_all();
+  for (size_t i = 0; i < threads_.size(); ++i)
+  {
+    threads_[i].join();
+  }
+}
+
+void ThreadPool::submit(const Task &task)
+{
+  size_t index = (tl_pool == this) ? tl_index :
+    next_worker_.fetch_add(1, std::memory_order_relaxed) % workers_.size();
+  {
+    std::lock_guard<std::mutex> lock(workers_[index]->mutex);
+    workers_[index]->tasks.push_back(task);
+  }
+  {
+    std::lock_guard<std::mutex> lock(wake_mutex_);
+    ++pending_;
+  }
+  wake_.notify_one();
+}
+
+size_t ThreadPool::size() const
+{
+  return threads_.size();
+}
+
+ThreadPool &ThreadPool::shared()
+{
+  static ThreadPool pool(shared_concurrency.load());
+  return pool;
+}
+
+void ThreadPool::setSharedConcurrency(size_t num_threads)
+{
+  shared_concurrency.store(num_threads);
+}
+
+bool ThreadPool::takeTask(size_t index, Task &task)
+{
+  {
+    Worker &own = *workers_[index];
+    std::lock_guard<std::mutex> lock(own.mutex);
+    if (!own.tasks.empty())
+    {
+      task.swap(own.tasks.back());
+      own.tasks.pop_back();
+      return true;
+    }
+  }
+
+  for (size_t i = 1; i < workers_.size(); ++i)
+  {
+    Worker &victim = *workers_[(index + i) % workers_.size()];
+    std::lock_guard<std::mutex> lock(victim.mutex);
+    if (!victim.tasks.empty())
+    {
+      task.swap(victim.tasks.front());
+      victim.tasks.pop_front();
+      return true;
+    }
+  }
+  return false;
+}
+
+void ThreadPool::workerLoop(size_t index)
+{
+  tl_pool = this;
+  tl_index = index;
+
+  Task task;
+  while (true)
+  {
+    if (takeTask(index, task))
+    {
+      --pending_;
+      task();
+      task = Task();
+      continue;
+    }
+
+    std::unique_lock<std::mutex> lock(wake_mutex_);
+    wake_.wait(lock, [this] { return stop_ || pending_ > 0; });
+    if (stop_ && pending_ <= 0)
+    {
+      return;
+    }
+  }
+}
+
+}  // namespace GeonavTransform
@@ -28,27 +28,70 @@ along with this package.  If not, see <http://www.gnu.org/licenses/>.
 
 #include <XmlRpcException.h>
 
+#include <cmath>
 #include <string>
 
 namespace GeonavTransform
 {
+namespace
+{
+  //! @brief Express a pose covariance (position, orientation) in a frame
+  //! rotated by rot relative to the original
+  template <typename Covariance>
+  void rotatePoseCovariance(const tf2::Matrix3x3 &rot, const Covariance &in,
+			    Covariance &out)
+  {
+    Eigen::Matrix3d r;
+    for (int i = 0; i < 3; ++i)
+    {
+      for (int j = 0; j < 3; ++j)
+      {
+	r(i, j) = rot[i][j];
+      }
+    }
+    Eigen::Matrix<double, 6, 6> r6 = Eigen::Matrix<double, 6, 6>::Zero();
+    r6.topLeftCorner<3, 3>() = r;
+    r6.bottomRightCorner<3, 3>() = r;
+    Eigen::Map<const Eigen::Matrix<double, 6, 6, Eigen::RowMajor> > cov_in(&in[0]);
+    Eigen::Map<Eigen::Matrix<double, 6, 6, Eigen::RowMajor> > cov_out(&out[0]);
+    cov_out = r6 * cov_in * r6.transpose();
+  }
+}  // namespace
+
 GeonavTransform::GeonavTransform() :
   // Initialize attributes
-  broadcast_utm2odom_transform_(true),
-  broadcast_odom2base_transform_(true),
-  nav_frame_id_(""),
-  zero_altitude_(true),
-  utm_frame_id_("utm"),
-  odom_frame_id_("odom"),
   base_link_frame_id_("base_link"),
+  odom_frame_id_("odom"),
+  utm_frame_id_("utm"),
+  settings_(NULL),
+  base_link_frame_(GeonavUtilities::FrameIdTable::EMPTY),
+  nav_frame_id_(""),
+  nav_frame_(GeonavUtilities::FrameIdTable::EMPTY),
+  nav_converted_(false),
+  batch_size_(0),
+  batch_period_(0.0),
+  nav_timeout_(1.0),
+  nav_healthy_(false),
+  lever_arm_compensation_(false),
+  lever_arm_frame_(GeonavUtilities::FrameIdTable::EMPTY),
+  lever_arm_stale_(true),
   utm_zone_(""),
-  tf_listener_(tf_buffer_)
+  moving_datum_(false),
+  ship_frame_id_("ship"),
+  soundings_(false),
+  coverage_(false),
+  coverage_swath_width_(0.0),
+  coverage_full_period_(0.0),
+  neighbour_zone_frames_(false),
+  path_spacing_(0.0),
+  path_tolerance_(0.0)
 {
   // Initialize transforms
   transform_odom2base_=tf2::Transform(tf2::Transform::getIdentity());
   transform_odom2base_inverse_=tf2::Transform(tf2::Transform::getIdentity());
   transform_utm2odom_=tf2::Transform(tf2::Transform::getIdentity());
   transform_utm2odom_inverse_=tf2::Transform(tf2::Transform::getIdentity());
+  transform_nav2base_=tf2::Transform(tf2::Transform::getIdentity());
 }
 
 GeonavTransform::~GeonavTransform()
@@ -58,21 +101,38 @@ GeonavTransform::~GeonavTransform()
 void GeonavTransform::run()
 {
   
-  double frequency = 10.0;
   double delay = 0.0;
   
   ros::NodeHandle nh;
   ros::NodeHandle nh_priv("~");
   
-  nav_update_time_ = ros::Time::now();
-
   // Load ROS parameters
-  nh_priv.param("frequency", frequency, 10.0);
-  nh_priv.param("orientation_ned", orientation_ned_, true);
+  // frequency, orientation_ned, broadcast_utm2odom_transform,
+  // broadcast_odom2base_transform and zero_altitude are loaded by the
+  // dynamic_reconfigure server, which calls reconfigureCallback right away
+  reconfigure_server_.reset(
+    new dynamic_reconfigure::Server<geonav_transform::GeonavTransformConfig>(nh_priv));
+  reconfigure_server_->setCallback(
+    boost::bind(&GeonavTransform::reconfigureCallback, this, _1, _2));
 
-  nh_priv.param("broadcast_utm2odom_transform", broadcast_utm2odom_transform_, true);
-  nh_priv.param("broadcast_odom2base_transform", broadcast_odom2base_transform_, true);
-  nh_priv.param("zero_altitude", zero_altitude_, false);
+  nh_priv.param("lever_arm_compensation", lever_arm_compensation_, false);
+  nh_priv.param("nav_timeout", nav_timeout_, 1.0);
+  nh_priv.param("neighbour_zone_frames", neighbour_zone_frames_, false);
+  nh_priv.param("moving_datum", moving_datum_, false);
+  nh_priv.param<std::string>("ship_frame_id", ship_frame_id_, "ship");
+  int ship_history_size;
+  nh_priv.param("ship_history_size", ship_history_size, 512);
+  if (ship_history_size < 2)
+  {
+    ROS_FATAL_STREAM("ERROR ship_history_size config: must be at least 2, got "
+		     << ship_history_size);
+    exit(1);
+  }
+  ship_history_ = PoseHistory(ship_history_size);
+  nh_priv.param("batch_size", batch_size_, 0);
+  nh_priv.param("batch_period", batch_period_, 0.0);
+  nh_priv.param("path_spacing", path_spacing_, 0.0);
+  nh_priv.param("path_tolerance", path_tolerance_, 0.0);
   nh_priv.param<std::string>("base_link_frame_id", base_link_frame_id_, "base_link");
   nh_priv.param<std::string>("odom_frame_id", odom_frame_id_, "odom");
   nh_priv.param<std::string>("utm_frame_id", utm_frame_id_, "utm");
@@ -83,6 +143,14 @@ void GeonavTransform::run()
   double datum_yaw;
   tf2::Quaternion quat = tf2::Quaternion::getIdentity();
 
+  // Try to resolve tf_prefix
+  std::string tf_prefix = "";
+  std::string tf_prefix_path = "";
+  if (nh_priv.searchParam("tf_prefix", tf_prefix_path))
+  {
+    nh_priv.getParam(tf_prefix_path, tf_prefix);
+  }
+
   if ( (! nh_priv.hasParam("datum")) && (! nh.hasParam("/geonav_datum")) )
   {
     ROS_FATAL("Neither global </geonav_datum> "
@@ -163,18 +231,12 @@ void GeonavTransform::run()
     }
     datum_yaw = 0.0;
 
-    // Try to resolve tf_prefix
-    std::string tf_prefix = "";
-    std::string tf_prefix_path = "";
-    if (nh_priv.searchParam("tf_prefix", tf_prefix_path))
-    {
-      nh_priv.getParam(tf_prefix_path, tf_prefix);
-    }
-    
     // Append the tf prefix in a tf2-friendly manner
     GeonavUtilities::appendPrefix(tf_prefix, utm_frame_id_);
     GeonavUtilities::appendPrefix(tf_prefix, odom_frame_id_);
     GeonavUtilities::appendPrefix(tf_prefix, base_link_frame_id_);
+    GeonavUtilities::appendPrefix(tf_prefix, ship_frame_id_);
+    base_link_frame_ = frame_ids_.resolve(base_link_frame_id_);
     
     // Convert specified yaw to quaternion 
     // Not currently effective since we ignore the yaw!
@@ -188,57 +250,253 @@ void GeonavTransform::run()
   nav_in_utm_.header.frame_id = utm_frame_id_;
   nav_in_utm_.child_frame_id = base_link_frame_id_;
   nav_in_utm_.header.seq = 0;
+  utm_batch_.header.frame_id = utm_frame_id_;
+  utm_batch_.child_frame_id = base_link_frame_id_;
+  utm_batch_.header.seq = 0;
   transform_msg_utm2odom_.header.frame_id = utm_frame_id_;
   transform_msg_utm2odom_.child_frame_id = odom_frame_id_;
   transform_msg_utm2odom_.header.seq = 0;
   transform_msg_odom2base_.header.frame_id = odom_frame_id_;
   transform_msg_odom2base_.child_frame_id = base_link_frame_id_;
   transform_msg_odom2base_.header.seq = 0;
+  transform_msg_utm2ship_.header.frame_id = utm_frame_id_;
+  transform_msg_utm2ship_.child_frame_id = ship_frame_id_;
+  transform_msg_utm2ship_.header.seq = 0;
+  nav_in_ship_.header.frame_id = ship_frame_id_;
+  nav_in_ship_.child_frame_id = base_link_frame_id_;
+  nav_in_ship_.header.seq = 0;
+  path_in_odom_.header.frame_id = odom_frame_id_;
+  path_in_odom_.header.seq = 0;
+  pose_array_in_odom_.header.frame_id = odom_frame_id_;
+  pose_array_in_odom_.header.seq = 0;
 
   // Set datum - published static transform
   setDatum(datum_lat, datum_lon, 0.0, quat); // alt is 0.0 for now
+  // Named datums - share the projection of the primary one
+  loadDatums(nh, nh_priv, tf_prefix);
+  // Geofence - projected once into the odom frame
+  loadGeofence(nh, nh_priv);
+  // Sonar soundings - georeferenced against the base_link pose history
+  loadSoundings(nh, nh_priv);
+  // Survey coverage - rasterized in the odom frame
+  loadCoverage(nh, nh_priv);
+
+  // Mission path - from a parameter or the mission_path topic
+  double reacquire;
+  nh_priv.param("mission_path_reacquire", reacquire, 200.0);
+  mission_path_ = MissionPath(reacquire);
+  std::vector<double> mission_path;
+  if (nh_priv.getParam("mission_path", mission_path))
+  {
+    std::vector<double> lat(mission_path.size() / 2);
+    std::vector<double> lon(mission_path.size() / 2);
+    for (size_t i = 0; i < lat.size(); ++i)
+    {
+      lat[i] = mission_path[2*i];
+      lon[i] = mission_path[2*i + 1];
+    }
+    mission_path_.setPath(datum_, lat.data(), lon.data(), lat.size());
+    ROS_INFO_STREAM("Mission path with " << mission_path_.legs() << " legs");
+  }
+  mission_status_.header.frame_id = odom_frame_id_;
+  mission_status_.header.seq = 0;
+  mission_pub_ = nh.advertise<geonav_transform::MissionPathStatus>("mission_path_status", 10);
+  mission_path_sub_ = nh.subscribe("mission_path", 1,
+				   &GeonavTransform::missionPathCallback,
+				   this);
 
   // Publisher - Odometry relative to the odom frame
   odom_pub_ = nh.advertise<nav_msgs::Odometry>("geonav_odom", 10);
   utm_pub_ = nh.advertise<nav_msgs::Odometry>("geonav_utm", 10);
 
+  // Publisher - Batched odometry relative to the utm frame
+  if (batch_size_ > 0 || batch_period_ > 0.0)
+  {
+    utm_batch_pub_ = nh.advertise<geonav_transform::OdometryBatch>("geonav_utm_batch", 10);
+    // Preallocate; a time window only batch grows to its steady size once
+    size_t capacity = (batch_size_ > 0) ? batch_size_ : 64;
+    utm_batch_.stamps.reserve(capacity);
+    utm_batch_.poses.reserve(capacity);
+    utm_batch_.twists.reserve(capacity);
+  }
+
   // Publisher - Odometry in Geo frame
   geo_pub_ = nh.advertise<nav_msgs::Odometry>("geonav_geo", 10);
+
+  // Publishers - Geo arrays converted to the odom frame
+  path_pub_ = nh.advertise<nav_msgs::Path>("geonav_path", 10);
+  pose_array_pub_ = nh.advertise<geometry_msgs::PoseArray>("geonav_pose_array", 10);
   
+  // Only pay for a TF listener if something needs it
+  if (lever_arm_compensation_)
+  {
+    tf_buffer_.reset(new tf2_ros::Buffer());
+    tf_listener_.reset(new tf2_ros::TransformListener(*tf_buffer_));
+    ROS_INFO("TF listener enabled (lever arm compensation)");
+
+    // Subscriber - static transforms, to know when the lever arm changes
+    tf_static_sub_ = nh.subscribe("/tf_static", 10,
+				  &GeonavTransform::tfStaticCallback,
+				  this);
+  }
+  else
+  {
+    ROS_INFO("Lightweight mode, TF listener disabled");
+  }
+
+  // Publisher - Health of the nav input, latched
+  health_pub_ = nh.advertise<std_msgs::Bool>("geonav_healthy", 1, true);
+  publishHealth();
+
+  // Timers - started by the first nav message
+  // TF broadcast at the requested frequency
+  tf_timer_ = nh.createTimer(ros::Duration(1.0/settings()->frequency),
+			     &GeonavTransform::tfTimerCallback, this,
+			     false, false);
+  // One-shot watchdog, fires when the nav input goes stale
+  watchdog_timer_ = nh.createTimer(ros::Duration(nav_timeout_),
+				   &GeonavTransform::watchdogCallback, this,
+				   true, false);
+
   // Subscriber - Odometry in GPS frame.
   // for converstion from geo. coord. to local nav. coord.
-  ros::Subscriber geo_odom_sub = nh.subscribe("nav_odom", 1,
-					  &GeonavTransform::navOdomCallback,
-					  this);
+  nav_odom_sub_ = nh.subscribe("nav_odom", 1,
+			       &GeonavTransform::navOdomCallback,
+			       this);
   // Subscriber - Odometry in Nav. frame.
   // for conversion from local nav. coord. to geo. coord
-  ros::Subscriber nav_odom_sub = nh.subscribe("geo_odom", 1,
+  ros::Subscriber geo_odom_sub = nh.subscribe("geo_odom", 1,
 					  &GeonavTransform::geoOdomCallback,
 					  this);
-  
-  
-  // Loop
-  ros::Rate rate(frequency);
-  while (ros::ok())
+  // Moving datum - vehicle relative to the ship
+  if (moving_datum_)
   {
-    ros::spinOnce();
+    ship_pub_ = nh.advertise<nav_msgs::Odometry>("geonav_ship_odom", 10);
+    ship_odom_sub_ = nh.subscribe("ship_nav_odom", 10,
+				  &GeonavTransform::shipOdomCallback,
+				  this);
+  }
+  // Subscribers - Arrays of geo poses (e.g., tracked contacts)
+  // for conversion from geo. coord. to local nav. coord.
+  geo_path_sub_ = nh.subscribe("geo_path", 10,
+			       &GeonavTransform::geoPathCallback,
+			       this);
+  geo_pose_array_sub_ = nh.subscribe("geo_pose_array", 10,
+				     &GeonavTransform::geoPoseArrayCallback,
+				     this);
 
-    // Check for odometry 
-    if ( (ros::Time::now().toSec()-nav_update_time_.toSec()) > 1.0 ){
-      ROS_WARN_STREAM("Haven't received Odometry on <"
-		      << geo_odom_sub.getTopic() << "> for 1.0 seconds!" 
-		      << " Will not broadcast transform!");
-    }
-    else{
-      // send transforms - particularly odom->base (utm->odom is static)
-      broadcastTf();
-    }
-    rate.sleep();
-  } // end of Loop
+  ros::spin();
 } // end of ::run()
 
+void GeonavTransform::publishHealth(void)
+{
+  std_msgs::Bool health;
+  health.data = nav_healthy_;
+  health_pub_.publish(health);
+}
+
+void GeonavTransform::armWatchdog(const ros::Duration &timeout)
+{
+  watchdog_timer_.stop();
+  watchdog_timer_.setPeriod(timeout);
+  watchdog_timer_.start();
+}
+
+void GeonavTransform::watchdogCallback(const ros::TimerEvent &event)
+{
+  // The timer isn't re-armed on every message; if nav arrived since it
+  // was armed, sleep for the rest of the timeout instead.
+  ros::Duration elapsed = ros::Time::now() - nav_update_time_;
+  if (elapsed.toSec() < nav_timeout_)
+  {
+    armWatchdog(ros::Duration(nav_timeout_ - elapsed.toSec()));
+    return;
+  }
+
+  ROS_WARN_STREAM("Haven't received Odometry on <"
+		  << nav_odom_sub_.getTopic() << "> for " << nav_timeout_
+		  << " seconds!" << " Will not broadcast transform!");
+  nav_healthy_ = false;
+  tf_timer_.stop();
+  publishHealth();
+  flushBatch();
+  // Don't sweep the swath across the gap
+  coverage_grid_.breakTrack();
+}
+
+void GeonavTransform::tfTimerCallback(const ros::TimerEvent &event)
+{
+  const Settings *settings = this->settings();
+  if (!settings->broadcast_odom2base_transform)
+  {
+    return;
+  }
+  // Catch up on a nav message that no output has converted yet
+  if (!nav_converted_ && latest_nav_)
+  {
+    convertNav(*latest_nav_, *settings);
+  }
+  // send transforms - particularly odom->base (utm->odom is static)
+  broadcastTf();
+}
+
+const GeonavTransform::Settings *GeonavTransform::settings() const
+{
+  return settings_.load(std::memory_order_acquire);
+}
+
+void GeonavTransform::reconfigureCallback(
+  geonav_transform::GeonavTransformConfig &config, uint32_t level)
+{
+  // Owned until the node goes, readers may still hold older snapshots
+  std::unique_ptr<Settings> owned(new Settings());
+  Settings *next = owned.get();
+  settings_history_.push_back(std::move(owned));
+  next->frequency = config.frequency;
+  next->zero_altitude = config.zero_altitude;
+  next->orientation_ned = config.orientation_ned;
+  next->broadcast_utm2odom_transform = config.broadcast_utm2odom_transform;
+  next->broadcast_odom2base_transform = config.broadcast_odom2base_transform;
+  next->utm_rate = config.utm_rate;
+  next->odom_rate = config.odom_rate;
+  next->geo_rate = config.geo_rate;
+
+  // Release, so a reader that sees the pointer sees the fields too
+  const Settings *prev = settings_.exchange(next, std::memory_order_acq_rel);
+  if (!prev)
+  {
+    // Initial configuration, nothing is running yet
+    return;
+  }
+
+  ROS_INFO_STREAM("Reconfigured: frequency " << next->frequency
+		  << ", zero_altitude " << next->zero_altitude
+		  << ", broadcast_utm2odom_transform "
+		  << next->broadcast_utm2odom_transform
+		  << ", broadcast_odom2base_transform "
+		  << next->broadcast_odom2base_transform
+		  << ", utm_rate " << next->utm_rate
+		  << ", odom_rate " << next->odom_rate
+		  << ", geo_rate " << next->geo_rate);
+  if (next->frequency != prev->frequency)
+  {
+    tf_timer_.setPeriod(ros::Duration(1.0/next->frequency));
+  }
+  if (next->zero_altitude != prev->zero_altitude ||
+      (next->broadcast_utm2odom_transform &&
+       !prev->broadcast_utm2odom_transform))
+  {
+    sendUtm2OdomTransform(*next);
+  }
+}
+
 void GeonavTransform::broadcastTf(void)
 {
+  if (!settings()->broadcast_odom2base_transform)
+  {
+    return;
+  }
+
   transform_msg_odom2base_.header.stamp = ros::Time::now();
   transform_msg_odom2base_.header.seq++;
   transform_msg_odom2base_.transform = tf2::toMsg(transform_odom2base_);
@@ -247,9 +505,10 @@ void GeonavTransform::broadcastTf(void)
 bool GeonavTransform::setDatum(double lat, double lon, double alt, 
 			       tf2::Quaternion q)
 {
-  double utm_x = 0;
-  double utm_y = 0;
-  NavsatConversions::LLtoUTM(lat, lon, utm_y, utm_x, utm_zone_);
+  datum_ = GeonavBatch::makeDatum(lat, lon, alt);
+  utm_zone_ = GeonavBatch::zoneString(datum_);
+  const double utm_x = datum_.easting;
+  const double utm_y = datum_.northing;
   
   ROS_INFO_STREAM("Datum (latitude, longitude, altitude) is (" 
 		  << std::fixed << lat << ", "
@@ -274,19 +533,713 @@ bool GeonavTransform::setDatum(double lat, double lon, double alt,
   //ROS_INFO_STREAM("Transform utm -> odom is: " << transform_utm2odom_);
 
   // Send out static UTM transform - frames are specified in ::run()
+  sendUtm2OdomTransform(*settings());
+  if (neighbour_zone_frames_)
+  {
+    sendNeighbourZoneTransforms();
+  }
+
+  return true;
+} // end setDatum
+
+void GeonavTransform::sendUtm2OdomTransform(const Settings &settings)
+{
+  if (!settings.broadcast_utm2odom_transform)
+  {
+    return;
+  }
   transform_msg_utm2odom_.header.stamp = ros::Time::now();
   transform_msg_utm2odom_.header.seq++;
   transform_msg_utm2odom_.transform = tf2::toMsg(transform_utm2odom_);
-  transform_msg_utm2odom_.transform.translation.z = (zero_altitude_ ? 0.0 : transform_msg_utm2odom_.transform.translation.z);
+  transform_msg_utm2odom_.transform.translation.z = (settings.zero_altitude ? 0.0 : transform_msg_utm2odom_.transform.translation.z);
   utm_broadcaster_.sendTransform(transform_msg_utm2odom_);
 
+  for (size_t i = 0; i < datums_.size(); ++i)
+  {
+    NamedDatum &datum = datums_[i];
+    datum.transform_msg.header.stamp = transform_msg_utm2odom_.header.stamp;
+    datum.transform_msg.header.seq++;
+    datum.transform_msg.transform = tf2::toMsg(datum.transform_utm2datum);
+    datum.transform_msg.transform.translation.z = (settings.zero_altitude ? 0.0 : datum.transform_msg.transform.translation.z);
+    utm_broadcaster_.sendTransform(datum.transform_msg);
+  }
+}
+
+void GeonavTransform::loadDatums(ros::NodeHandle &nh,
+				 ros::NodeHandle &nh_priv,
+				 const std::string &tf_prefix)
+{
+  if (!nh_priv.hasParam("datums"))
+  {
+    return;
+  }
+  XmlRpc::XmlRpcValue datums_config;
+  try
+  {
+    nh_priv.getParam("datums", datums_config);
+    ROS_ASSERT(datums_config.getType() == XmlRpc::XmlRpcValue::TypeStruct);
+    for (XmlRpc::XmlRpcValue::iterator it = datums_config.begin();
+	 it != datums_config.end(); ++it)
+    {
+      // [latitude, longitude, altitude, (yaw)]
+      XmlRpc::XmlRpcValue &config = it->second;
+      ROS_ASSERT(config.getType() == XmlRpc::XmlRpcValue::TypeArray);
+      ROS_ASSERT(config.size() >= 3);
+      std::ostringstream ostr;
+      ostr << config[0] << " " << config[1] << " " << config[2];
+      if (config.size() > 3)
+      {
+	ostr << " " << config[3];
+      }
+      std::istringstream istr(ostr.str());
+      double lat, lon, alt;
+      double yaw = 0.0;
+      istr >> lat >> lon >> alt;
+      if (config.size() > 3)
+      {
+	istr >> yaw;
+      }
+
+      // Projected into the primary datum's zone, not its own, so one
+      // projection of each fix serves every datum
+      double northing, easting;
+      GeonavBatch::LLtoUTM(&lat, &lon, 1, datum_.zone, datum_.north,
+			   &northing, &easting);
+
+      NamedDatum datum;
+      datum.frame_id = it->first;
+      GeonavUtilities::appendPrefix(tf_prefix, datum.frame_id);
+      tf2::Quaternion q;
+      q.setRPY(0.0, 0.0, yaw);
+      datum.transform_utm2datum.setOrigin(tf2::Vector3(easting, northing, alt));
+      datum.transform_utm2datum.setRotation(q);
+      datum.transform_datum2utm = datum.transform_utm2datum.inverse();
+      datum.transform_msg.header.frame_id = utm_frame_id_;
+      datum.transform_msg.child_frame_id = datum.frame_id;
+      datum.transform_msg.header.seq = 0;
+      datum.nav_in_datum.header.frame_id = datum.frame_id;
+      datum.nav_in_datum.child_frame_id = base_link_frame_id_;
+      datum.nav_in_datum.header.seq = 0;
+      datum.pub = nh.advertise<nav_msgs::Odometry>("geonav_odom/" + it->first, 10);
+      datums_.push_back(datum);
+
+      ROS_INFO_STREAM("Datum " << datum.frame_id << " (latitude, longitude, "
+		      "altitude, yaw) is (" << std::fixed << lat << ", "
+		      << lon << ", " << alt << ", " << yaw << ")");
+    }
+  }
+  catch (XmlRpc::XmlRpcException &e)
+  {
+    ROS_FATAL_STREAM("ERROR datums config: " << e.getMessage() <<
+		     " for geonav_transform (type: "
+		     << datums_config.getType() << ")");
+    exit(1);
+  }
+
+  // Resend the static transforms, now including the named datums
+  sendUtm2OdomTransform(*settings());
+}
+
+void GeonavTransform::publishDatums(const Settings &settings)
+{
+  for (size_t i = 0; i < datums_.size(); ++i)
+  {
+    NamedDatum &datum = datums_[i];
+    // datum2base = datum2utm * utm2base - the fix was projected once
+    tf2::Transform transform_datum2base;
+    transform_datum2base.mult(datum.transform_datum2utm, transform_utm2base_);
+
+    nav_msgs::Odometry &nav = datum.nav_in_datum;
+    nav.header.stamp = nav_update_time_;
+    nav.header.seq++;
+    tf2::toMsg(transform_datum2base, nav.pose.pose);
+    nav.pose.pose.position.z = (settings.zero_altitude ? 0.0 : nav.pose.pose.position.z);
+    if (!lever_arm_compensation_)
+    {
+      // Rotate the reported orientation, as for the odom frame
+      tf2::Quaternion q;
+      tf2::fromMsg(nav_in_utm_.pose.pose.orientation, q);
+      nav.pose.pose.orientation =
+	tf2::toMsg(datum.transform_datum2utm.getRotation() * q);
+    }
+    // Pose covariance rotates with the frame; twist is in base_link
+    rotatePoseCovariance(datum.transform_datum2utm.getBasis(),
+			 nav_in_utm_.pose.covariance, nav.pose.covariance);
+    nav.twist = nav_in_utm_.twist;
+    datum.pub.publish(nav);
+  }
+}
+
+void GeonavTransform::loadGeofence(ros::NodeHandle &nh,
+				   ros::NodeHandle &nh_priv)
+{
+  if (!nh_priv.hasParam("geofence/polygons"))
+  {
+    return;
+  }
+  XmlRpc::XmlRpcValue polygons;
+  double cell_size;
+  nh_priv.param("geofence/cell_size", cell_size, 50.0);
+  try
+  {
+    nh_priv.getParam("geofence/polygons", polygons);
+    ROS_ASSERT(polygons.getType() == XmlRpc::XmlRpcValue::TypeArray);
+    for (int i = 0; i < polygons.size(); ++i)
+    {
+      // {keep_out: bool, points: [lat0, lon0, lat1, lon1, ...]}
+      XmlRpc::XmlRpcValue &polygon = polygons[i];
+      ROS_ASSERT(polygon.getType() == XmlRpc::XmlRpcValue::TypeStruct);
+      bool keep_out = (polygon.hasMember("keep_out") &&
+		       static_cast<bool>(polygon["keep_out"]));
+      XmlRpc::XmlRpcValue &points = polygon["points"];
+      ROS_ASSERT(points.getType() == XmlRpc::XmlRpcValue::TypeArray);
+      ROS_ASSERT(points.size() >= 6 && points.size() % 2 == 0);
+      std::ostringstream ostr;
+      for (int j = 0; j < points.size(); ++j)
+      {
+	ostr << points[j] << " ";
+      }
+      std::istringstream istr(ostr.str());
+      std::vector<double> lat(points.size() / 2);
+      std::vector<double> lon(points.size() / 2);
+      for (size_t j = 0; j < lat.size(); ++j)
+      {
+	istr >> lat[j] >> lon[j];
+      }
+      geofence_.addPolygon(datum_, lat.data(), lon.data(), lat.size(),
+			   keep_out);
+    }
+  }
+  catch (XmlRpc::XmlRpcException &e)
+  {
+    ROS_FATAL_STREAM("ERROR geofence config: " << e.getMessage() <<
+		     " for geonav_transform (type: "
+		     << polygons.getType() << ")");
+    exit(1);
+  }
+  geofence_.build(cell_size);
+  ROS_INFO_STREAM("Geofence with " << geofence_.size() << " polygons");
+
+  geofence_status_.header.frame_id = odom_frame_id_;
+  geofence_status_.header.seq = 0;
+  geofence_pub_ = nh.advertise<geonav_transform::GeofenceStatus>("geofence_status", 10);
+}
+
+void GeonavTransform::checkGeofence(void)
+{
+  if (geofence_.size() == 0)
+  {
+    return;
+  }
+  const tf2::Vector3 &position = transform_odom2base_.getOrigin();
+  Geofence::Result result = geofence_.check(position.x(), position.y());
+
+  geofence_status_.changed = (geofence_status_.header.seq == 0 ||
+			      result.inside != geofence_status_.inside);
+  if (geofence_status_.changed && !result.inside)
+  {
+    ROS_WARN_STREAM("Geofence breach, " << -result.distance
+		    << " m outside (polygon " << result.polygon << ")");
+  }
+  else if (geofence_status_.changed && geofence_status_.header.seq > 0)
+  {
+    ROS_INFO_STREAM("Back inside the geofence");
+  }
+  geofence_status_.header.stamp = nav_update_time_;
+  geofence_status_.header.seq++;
+  geofence_status_.inside = result.inside;
+  geofence_status_.distance = result.distance;
+  geofence_status_.polygon = result.polygon;
+  geofence_pub_.publish(geofence_status_);
+}
+
+void GeonavTransform::loadSoundings(ros::NodeHandle &nh,
+				    ros::NodeHandle &nh_priv)
+{
+  nh_priv.param("soundings", soundings_, false);
+  if (!soundings_)
+  {
+    return;
+  }
+  // Sonar pose in base_link
+  std::vector<double> lever_arm;
+  std::vector<double> mount_rpy;
+  nh_priv.getParam("sonar/lever_arm", lever_arm);
+  nh_priv.getParam("sonar/mount_rpy", mount_rpy);
+  lever_arm.resize(3, 0.0);
+  mount_rpy.resize(3, 0.0);
+  int history_size;
+  nh_priv.param("sonar/history_size", history_size, 512);
+  if (history_size < 2)
+  {
+    ROS_FATAL_STREAM("ERROR sonar/history_size config: must be at least 2, got "
+		     << history_size);
+    exit(1);
+  }
+
+  sounding_georeferencer_ = SoundingGeoreferencer(history_size);
+  sounding_georeferencer_.setDatum(datum_);
+  sounding_georeferencer_.setMaxGap(nav_timeout_);
+  sounding_georeferencer_.setMount(lever_arm[0], lever_arm[1], lever_arm[2],
+				   mount_rpy[0], mount_rpy[1], mount_rpy[2]);
+  ROS_INFO_STREAM("Georeferencing soundings, sonar at ("
+		  << lever_arm[0] << ", " << lever_arm[1] << ", "
+		  << lever_arm[2] << ") in " << base_link_frame_id_);
+
+  soundings_out_.header.frame_id = odom_frame_id_;
+  soundings_out_.header.seq = 0;
+  soundings_pub_ = nh.advertise<geonav_transform::Soundings>("geonav_soundings", 10);
+  sonar_ping_sub_ = nh.subscribe("sonar_ping", 10,
+				 &GeonavTransform::sonarPingCallback,
+				 this);
+}
+
+void GeonavTransform::sonarPingCallback(const geonav_transform::SonarPingConstPtr& msg)
+{
+  const size_t count = msg->ranges.size();
+  if (msg->across_angles.size() != count ||
+      (!msg->along_angles.empty() && msg->along_angles.size() != count) ||
+      (!msg->time_offsets.empty() && msg->time_offsets.size() != count))
+  {
+    ROS_WARN_STREAM_THROTTLE(5.0, "Sonar ping with mismatched beam "
+			     "arrays, dropped");
+    return;
+  }
+
+  SoundingGeoreferencer::Ping ping;
+  ping.stamp = msg->header.stamp.toSec();
+  ping.count = count;
+  ping.range = msg->ranges.data();
+  ping.across = msg->across_angles.data();
+  ping.along = (msg->along_angles.empty() ? NULL : msg->along_angles.data());
+  ping.time_offset = (msg->time_offsets.empty() ? NULL
+		      : msg->time_offsets.data());
+
+  // Resized in place, keeping their capacity between pings
+  soundings_out_.x.resize(count);
+  soundings_out_.y.resize(count);
+  soundings_out_.z.resize(count);
+  soundings_out_.latitude.resize(count);
+  soundings_out_.longitude.resize(count);
+  soundings_out_.altitude.resize(count);
+  SoundingGeoreferencer::Soundings out;
+  out.x = soundings_out_.x.data();
+  out.y = soundings_out_.y.data();
+  out.z = soundings_out_.z.data();
+  out.latitude = soundings_out_.latitude.data();
+  out.longitude = soundings_out_.longitude.data();
+  out.altitude = soundings_out_.altitude.data();
+
+  size_t referenced = sounding_georeferencer_.georeference(ping, out);
+  if (referenced < count)
+  {
+    ROS_WARN_STREAM_THROTTLE(5.0, count - referenced << " of " << count
+			     << " beams have no vehicle pose");
+  }
+  if (coverage_)
+  {
+    coverage_grid_.addSoundings(out.x, out.y, count);
+  }
+  soundings_out_.header.stamp = msg->header.stamp;
+  soundings_out_.header.seq++;
+  soundings_pub_.publish(soundings_out_);
+}
+
+void GeonavTransform::loadCoverage(ros::NodeHandle &nh,
+				   ros::NodeHandle &nh_priv)
+{
+  nh_priv.param("coverage/enable", coverage_, false);
+  if (!coverage_)
+  {
+    return;
+  }
+  double resolution;
+  int max_tiles;
+  double max_step;
+  double publish_period;
+  nh_priv.param("coverage/resolution", resolution, 1.0);
+  nh_priv.param("coverage/max_tiles", max_tiles, 1024);
+  nh_priv.param("coverage/max_step", max_step, 50.0);
+  nh_priv.param("coverage/swath_width", coverage_swath_width_, 0.0);
+  nh_priv.param("coverage/publish_period", publish_period, 1.0);
+  nh_priv.param("coverage/full_period", coverage_full_period_, 10.0);
+  if (resolution <= 0.0 || max_tiles <= 0 || publish_period <= 0.0)
+  {
+    ROS_FATAL_STREAM("ERROR coverage config: resolution, max_tiles and "
+		     "publish_period must be positive");
+    exit(1);
+  }
+
+  coverage_grid_ = CoverageGrid(resolution, max_tiles);
+  coverage_grid_.setMaxStep(max_step);
+  ROS_INFO_STREAM("Coverage grid at " << resolution << " m, at most "
+		  << max_tiles << " tiles of " << CoverageGrid::TILE_SIZE
+		  << " cells");
+
+  coverage_out_.header.frame_id = odom_frame_id_;
+  coverage_out_.header.seq = 0;
+  coverage_out_.resolution = resolution;
+  coverage_out_.tile_size = CoverageGrid::TILE_SIZE;
+  coverage_pub_ = nh.advertise<geonav_transform::CoverageTiles>("geonav_coverage", 1);
+  swath_width_sub_ = nh.subscribe("coverage_swath_width", 1,
+				  &GeonavTransform::swathWidthCallback,
+				  this);
+  coverage_timer_ = nh.createTimer(ros::Duration(publish_period),
+				   &GeonavTransform::coverageTimerCallback,
+				   this);
+}
+
+void GeonavTransform::swathWidthCallback(const std_msgs::Float64ConstPtr& msg)
+{
+  coverage_swath_width_ = msg->data;
+}
+
+void GeonavTransform::coverageTimerCallback(const ros::TimerEvent &event)
+{
+  // Full refresh for late subscribers and dropped messages
+  bool full = (coverage_out_.header.seq == 0 ||
+	       (coverage_full_period_ > 0.0 &&
+		(event.current_real - coverage_full_time_).toSec()
+		>= coverage_full_period_));
+  if (coverage_grid_.encode(!full, coverage_encoded_) == 0 &&
+      coverage_out_.header.seq > 0)
+  {
+    return;
+  }
+  if (full)
+  {
+    coverage_full_time_ = event.current_real;
+  }
+  coverage_out_.tile_x.swap(coverage_encoded_.tile_x);
+  coverage_out_.tile_y.swap(coverage_encoded_.tile_y);
+  coverage_out_.tile_generation.swap(coverage_encoded_.generation);
+  coverage_out_.run_start.swap(coverage_encoded_.run_start);
+  coverage_out_.run_length.swap(coverage_encoded_.run_length);
+  coverage_out_.run_passes.swap(coverage_encoded_.run_passes);
+  coverage_out_.run_soundings.swap(coverage_encoded_.run_soundings);
+  coverage_out_.full = full;
+  coverage_out_.header.stamp = event.current_real;
+  coverage_out_.header.seq++;
+  coverage_pub_.publish(coverage_out_);
+}
+
+void GeonavTransform::missionPathCallback(const geographic_msgs::GeoPathConstPtr& msg)
+{
+  std::vector<double> lat(msg->poses.size());
+  std::vector<double> lon(msg->poses.size());
+  for (size_t i = 0; i < lat.size(); ++i)
+  {
+    lat[i] = msg->poses[i].pose.position.latitude;
+    lon[i] = msg->poses[i].pose.position.longitude;
+  }
+  mission_path_.setPath(datum_, lat.data(), lon.data(), lat.size());
+  ROS_INFO_STREAM("New mission path with " << mission_path_.legs() << " legs");
+}
+
+void GeonavTransform::trackMissionPath(void)
+{
+  MissionPath::Result result;
+  const tf2::Vector3 &position = transform_odom2base_.getOrigin();
+  if (!mission_path_.track(position.x(), position.y(), result))
+  {
+    return;
+  }
+  mission_status_.header.stamp = nav_update_time_;
+  mission_status_.header.seq++;
+  mission_status_.leg = result.leg;
+  mission_status_.cross_track = result.cross_track;
+  mission_status_.along_track = result.along_track;
+  mission_status_.remaining = result.remaining;
+  mission_status_.next_waypoint = result.next_waypoint;
+  mission_status_.next_waypoint_distance = result.next_waypoint_distance;
+  mission_status_.leg_heading = result.leg_heading;
+  mission_status_.complete = result.complete;
+  mission_pub_.publish(mission_status_);
+}
+
+void GeonavTransform::shipOdomCallback(const nav_msgs::OdometryConstPtr& msg)
+{
+  if (std::isnan(msg->pose.pose.position.x) ||
+      std::isnan(msg->pose.pose.position.y) ||
+      std::isnan(msg->pose.pose.position.z))
+  {
+    ROS_WARN_STREAM_THROTTLE(5.0, "Bad ship GPS!  Won't transform");
+    return;
+  }
+  tf2::Quaternion q(msg->pose.pose.orientation.x,
+		    msg->pose.pose.orientation.y,
+		    msg->pose.pose.orientation.z,
+		    msg->pose.pose.orientation.w);
+  if (q.length2() < 1e-6)
+  {
+    ROS_WARN_STREAM_THROTTLE(5.0, "Ship odometry has no orientation, "
+			     "assuming identity");
+    q = tf2::Quaternion::getIdentity();
+  }
+  q.normalize();
+
+  // Projected once here; vehicle fixes reuse it until the next update
+  PoseHistory::Sample sample;
+  sample.stamp = (msg->header.stamp.isZero() ? ros::Time::now()
+		  : msg->header.stamp).toSec();
+  GeonavBatch::LLtoUTM(&msg->pose.pose.position.y, &msg->pose.pose.position.x,
+		       1, datum_.zone, datum_.north, &sample.y, &sample.x);
+  sample.z = msg->pose.pose.position.z;
+  sample.qx = q.x();
+  sample.qy = q.y();
+  sample.qz = q.z();
+  sample.qw = q.w();
+  if (!ship_history_.push(sample))
+  {
+    ROS_WARN_STREAM_THROTTLE(5.0, "Ship odometry out of order, dropped");
+    return;
+  }
+
+  transform_msg_utm2ship_.header.stamp.fromSec(sample.stamp);
+  transform_msg_utm2ship_.header.seq++;
+  transform_msg_utm2ship_.transform.translation.x = sample.x;
+  transform_msg_utm2ship_.transform.translation.y = sample.y;
+  transform_msg_utm2ship_.transform.translation.z =
+    (settings()->zero_altitude ? 0.0 : sample.z);
+  transform_msg_utm2ship_.transform.rotation = tf2::toMsg(q);
+  tf_broadcaster_.sendTransform(transform_msg_utm2ship_);
+}
+
+void GeonavTransform::publishShip(const ros::Time &stamp,
+				  const Settings &settings)
+{
+  PoseHistory::Sample ship;
+  if (!ship_history_.interpolate(stamp.toSec(), nav_timeout_, ship))
+  {
+    ROS_WARN_STREAM_THROTTLE(5.0, "No ship pose at " << stamp
+			     << ", not publishing relative to "
+			     << ship_frame_id_);
+    return;
+  }
+  tf2::Transform transform_utm2ship(
+    tf2::Quaternion(ship.qx, ship.qy, ship.qz, ship.qw),
+    tf2::Vector3(ship.x, ship.y, ship.z));
+  // ship2base = ship2utm * utm2base
+  tf2::Transform transform_ship2base;
+  transform_ship2base.mult(transform_utm2ship.inverse(), transform_utm2base_);
+
+  nav_in_ship_.header.stamp = stamp;
+  nav_in_ship_.header.seq++;
+  tf2::toMsg(transform_ship2base, nav_in_ship_.pose.pose);
+  if (!lever_arm_compensation_)
+  {
+    tf2::Quaternion q;
+    tf2::fromMsg(nav_in_utm_.pose.pose.orientation, q);
+    nav_in_ship_.pose.pose.orientation =
+      tf2::toMsg(transform_utm2ship.getRotation().inverse() * q);
+  }
+  nav_in_ship_.pose.pose.position.z = (settings.zero_altitude ? 0.0 : nav_in_ship_.pose.pose.position.z);
+  rotatePoseCovariance(transform_utm2ship.getBasis().transpose(),
+		       nav_in_utm_.pose.covariance, nav_in_ship_.pose.covariance);
+  // Twist as is - base_link velocity over ground, not relative to the ship
+  nav_in_ship_.twist = nav_in_utm_.twist;
+  ship_pub_.publish(nav_in_ship_);
+}
+
+void GeonavTransform::sendNeighbourZoneTransforms(void)
+{
+  const int zones[] = {GeonavBatch::westZone(datum_.zone),
+		       GeonavBatch::eastZone(datum_.zone)};
+  for (size_t i = 0; i < 2; ++i)
+  {
+    GeonavBatch::ZoneTransform zone2datum =
+      GeonavBatch::zoneTransform(datum_, zones[i]);
+    tf2::Quaternion q;
+    q.setRPY(0.0, 0.0, zone2datum.yaw);
+
+    geometry_msgs::TransformStamped msg;
+    msg.header.stamp = ros::Time::now();
+    msg.header.frame_id = utm_frame_id_;
+    std::ostringstream child;
+    child << utm_frame_id_ << "_" << zones[i];
+    msg.child_frame_id = child.str();
+    msg.transform.translation.x = zone2datum.x;
+    msg.transform.translation.y = zone2datum.y;
+    msg.transform.translation.z = 0.0;
+    msg.transform.rotation = tf2::toMsg(q);
+    utm_broadcaster_.sendTransform(msg);
+    ROS_INFO_STREAM("Neighbour zone frame " << msg.child_frame_id
+		    << ": yaw " << zone2datum.yaw << " rad");
+  }
+}
+
+void GeonavTransform::tfStaticCallback(const tf2_msgs::TFMessageConstPtr& msg)
+{
+  lever_arm_stale_ = true;
+  lever_arm_retry_time_ = ros::Time(0);
+  if (lever_arm_pending_.empty())
+  {
+    lever_arm_pending_since_ = ros::Time::now();
+  }
+  // The listener gets the same message on its own subscription, possibly
+  // later; remember it so a lookup can tell whether it has been applied
+  for (size_t i = 0; i < msg->transforms.size(); ++i)
+  {
+    geometry_msgs::TransformStamped t = msg->transforms[i];
+    if (!t.header.frame_id.empty() && t.header.frame_id[0] == '/')
+    {
+      t.header.frame_id.erase(0, 1);
+    }
+    if (!t.child_frame_id.empty() && t.child_frame_id[0] == '/')
+    {
+      t.child_frame_id.erase(0, 1);
+    }
+    size_t j = 0;
+    while (j < lever_arm_pending_.size() &&
+	   lever_arm_pending_[j].child_frame_id != t.child_frame_id)
+    {
+      ++j;
+    }
+    if (j == lever_arm_pending_.size())
+    {
+      lever_arm_pending_.push_back(t);
+    }
+    else
+    {
+      lever_arm_pending_[j] = t;
+    }
+  }
+}
+
+bool GeonavTransform::leverArmPendingApplied()
+{
+  // Static transforms are looked up with a zero stamp, so compare values
+  const double tolerance = 1e-9;
+  for (size_t i = 0; i < lever_arm_pending_.size(); ++i)
+  {
+    const geometry_msgs::TransformStamped &want = lever_arm_pending_[i];
+    geometry_msgs::TransformStamped have;
+    try
+    {
+      have = tf_buffer_->lookupTransform(want.header.frame_id,
+					 want.child_frame_id, ros::Time(0));
+    }
+    catch (tf2::TransformException &e)
+    {
+      return false;
+    }
+    const geometry_msgs::Vector3 &a = want.transform.translation;
+    const geometry_msgs::Vector3 &b = have.transform.translation;
+    const geometry_msgs::Quaternion &p = want.transform.rotation;
+    const geometry_msgs::Quaternion &q = have.transform.rotation;
+    if (std::fabs(a.x - b.x) > tolerance || std::fabs(a.y - b.y) > tolerance ||
+	std::fabs(a.z - b.z) > tolerance ||
+	std::fabs(p.x - q.x) > tolerance || std::fabs(p.y - q.y) > tolerance ||
+	std::fabs(p.z - q.z) > tolerance || std::fabs(p.w - q.w) > tolerance)
+    {
+      return false;
+    }
+  }
   return true;
-} // end setDatum
+}
+
+void GeonavTransform::updateLeverArm()
+{
+  if (nav_frame_ != lever_arm_frame_)
+  {
+    lever_arm_frame_ = nav_frame_;
+    lever_arm_stale_ = true;
+    lever_arm_retry_time_ = ros::Time(0);
+  }
+  if (!lever_arm_stale_)
+  {
+    return;
+  }
+
+  // Sensor assumed to be at the robot's origin
+  if (!lever_arm_compensation_ ||
+      nav_frame_ == GeonavUtilities::FrameIdTable::EMPTY ||
+      nav_frame_ == base_link_frame_)
+  {
+    transform_nav2base_.setIdentity();
+    lever_arm_stale_ = false;
+    lever_arm_pending_.clear();
+    return;
+  }
+
+  // Don't retry a failed lookup on every message
+  ros::Time now = ros::Time::now();
+  if (now < lever_arm_retry_time_)
+  {
+    return;
+  }
+
+  // Looking up before the listener has the transforms that invalidated
+  // the cache would re-cache the old arm; stay stale until it does
+  if (!lever_arm_pending_.empty())
+  {
+    if (!leverArmPendingApplied())
+    {
+      if (now - lever_arm_pending_since_ < ros::Duration(1.0))
+      {
+	return;
+      }
+      ROS_WARN("Static transforms from /tf_static not in the TF buffer "
+	       "after 1 s, looking up the lever arm anyway");
+    }
+    lever_arm_pending_.clear();
+  }
+
+  const std::string &nav_frame_id = frame_ids_.name(nav_frame_);
+  try
+  {
+    // Static, so the latest transform is the one we want
+    geometry_msgs::TransformStamped base2nav =
+      tf_buffer_->lookupTransform(base_link_frame_id_, nav_frame_id,
+				 ros::Time(0));
+    tf2::Transform transform_base2nav;
+    tf2::fromMsg(base2nav.transform, transform_base2nav);
+    transform_nav2base_ = transform_base2nav.inverse();
+    lever_arm_stale_ = false;
+    ROS_INFO_STREAM("Lever arm " << nav_frame_id << "->"
+		    << base_link_frame_id_ << " is ("
+		    << transform_nav2base_.getOrigin()[0] << ", "
+		    << transform_nav2base_.getOrigin()[1] << ", "
+		    << transform_nav2base_.getOrigin()[2] << ")");
+  }
+  catch (tf2::TransformException &e)
+  {
+    ROS_WARN_STREAM_THROTTLE(5.0, "Could not obtain static transform "
+			     << base_link_frame_id_ << "->" << nav_frame_id
+			     << " (" << e.what() << "). Will assume navsat "
+			     "device is mounted at robot's origin.");
+    transform_nav2base_.setIdentity();
+    lever_arm_retry_time_ = now + ros::Duration(1.0);
+  }
+}
+
+void GeonavTransform::getRobotOriginUtmPose(const tf2::Transform &gps_utm_pose,
+					    tf2::Transform &robot_utm_pose,
+					    const ros::Time &transform_time)
+{
+  // utm2base = utm2nav * nav2base
+  robot_utm_pose.mult(gps_utm_pose, transform_nav2base_);
+}
+
+void GeonavTransform::getRobotOriginWorldPose(const tf2::Transform &gps_odom_pose,
+					      tf2::Transform &robot_odom_pose,
+					      const ros::Time &transform_time)
+{
+  // odom2base = odom2nav * nav2base
+  robot_odom_pose.mult(gps_odom_pose, transform_nav2base_);
+}
 
 void GeonavTransform::navOdomCallback(const nav_msgs::OdometryConstPtr& msg)
 {
-  nav_frame_id_ = msg->header.frame_id;
-  if (nav_frame_id_.empty())
+  const Settings *settings = this->settings();
+  // Only touch the frame strings when the frame changes
+  if (msg->header.frame_id != nav_frame_id_)
+  {
+    nav_frame_id_ = msg->header.frame_id;
+    // Strip leading slash for tf2 compliance
+    nav_frame_ = frame_ids_.resolve(nav_frame_id_);
+  }
+  if (nav_frame_ == GeonavUtilities::FrameIdTable::EMPTY)
   {
     ROS_WARN_STREAM_ONCE("Odometry message has empty frame_id. "
 			 "Will assume navsat device is mounted at "
@@ -303,56 +1256,225 @@ void GeonavTransform::navOdomCallback(const nav_msgs::OdometryConstPtr& msg)
     return;
   }
 
+  nav_update_time_ = ros::Time::now();
+  if (!nav_healthy_)
+  {
+    // Nav (re)acquired - resume TF and start watching for staleness
+    ROS_INFO_STREAM("Receiving Odometry on <" << nav_odom_sub_.getTopic()
+		    << ">");
+    nav_healthy_ = true;
+    publishHealth();
+    tf_timer_.start();
+    armWatchdog(ros::Duration(nav_timeout_));
+  }
+
+  // Convert only if an output is due; TF converts on its own schedule
+  latest_nav_ = msg;
+  nav_converted_ = false;
+  bool utm_due = utm_limiter_.due(nav_update_time_.toSec(), settings->utm_rate);
+  bool odom_due = odom_limiter_.due(nav_update_time_.toSec(), settings->odom_rate);
+  bool batching = utm_batch_pub_;
+  bool geofencing = (geofence_.size() > 0);
+  bool tracking = (mission_path_.legs() > 0);
+  if (!utm_due && !odom_due && !batching && !soundings_ && !coverage_ &&
+      !geofencing && !tracking)
+  {
+    return;
+  }
+  convertNav(*msg, *settings);
+
+  if (soundings_)
+  {
+    // Every fix, at the time of the fix, for interpolating beam times
+    PoseHistory::Sample sample;
+    sample.stamp = (msg->header.stamp.isZero() ? nav_update_time_
+		    : msg->header.stamp).toSec();
+    const tf2::Vector3 &position = transform_odom2base_.getOrigin();
+    sample.x = position.x();
+    sample.y = position.y();
+    sample.z = position.z();
+    sample.qx = nav_in_odom_.pose.pose.orientation.x;
+    sample.qy = nav_in_odom_.pose.pose.orientation.y;
+    sample.qz = nav_in_odom_.pose.pose.orientation.z;
+    sample.qw = nav_in_odom_.pose.pose.orientation.w;
+    if (!sounding_georeferencer_.addPose(sample))
+    {
+      ROS_WARN_STREAM_THROTTLE(5.0, "Odometry out of order, not used "
+			       "for soundings");
+    }
+  }
+  if (coverage_)
+  {
+    // Every fix, so the swath is swept without gaps
+    const tf2::Vector3 &position = transform_odom2base_.getOrigin();
+    const geometry_msgs::Quaternion &q = nav_in_odom_.pose.pose.orientation;
+    double yaw;
+    GeonavUtilities::quaternionToYaw(&q.x, &q.y, &q.z, &q.w, 1, &yaw);
+    coverage_grid_.addPose(position.x(), position.y(), yaw,
+			   coverage_swath_width_);
+  }
+
+  if (geofencing)
+  {
+    // Every fix, so a breach isn't held back by odom_rate
+    checkGeofence();
+  }
+  if (tracking)
+  {
+    // Every fix, path followers need the cross-track error at full rate
+    trackMissionPath();
+  }
+
+  if (batching)
+  {
+    appendBatch();
+  }
+  if (utm_due)
+  {
+    nav_in_utm_.header.seq++;
+    utm_pub_.publish(nav_in_utm_);
+  }
+  if (odom_due)
+  {
+    nav_in_odom_.header.seq++;
+    odom_pub_.publish(nav_in_odom_);
+    publishDatums(*settings);
+    if (moving_datum_)
+    {
+      // Align with the ship by the time of the fix, not of arrival
+      publishShip(msg->header.stamp.isZero() ? nav_update_time_ : msg->header.stamp,
+		  *settings);
+    }
+  }
+}  // navOdomCallback
+
+void GeonavTransform::appendBatch(void)
+{
+  if (utm_batch_.stamps.empty())
+  {
+    utm_batch_.header.stamp = nav_update_time_;
+  }
+  utm_batch_.stamps.push_back(nav_update_time_);
+  utm_batch_.poses.push_back(nav_in_utm_.pose.pose);
+  utm_batch_.twists.push_back(nav_in_utm_.twist.twist);
+
+  bool full = (batch_size_ > 0 &&
+	       utm_batch_.stamps.size() >= static_cast<size_t>(batch_size_));
+  bool expired = (batch_period_ > 0.0 &&
+		  (nav_update_time_ - utm_batch_.header.stamp).toSec() >= batch_period_);
+  if (full || expired)
+  {
+    flushBatch();
+  }
+}
+
+void GeonavTransform::flushBatch(void)
+{
+  if (utm_batch_.stamps.empty())
+  {
+    return;
+  }
+  utm_batch_.header.seq++;
+  utm_batch_pub_.publish(utm_batch_);
+  utm_batch_.stamps.clear();
+  utm_batch_.poses.clear();
+  utm_batch_.twists.clear();
+}
+
+void GeonavTransform::convertNav(const nav_msgs::Odometry &msg,
+				 const Settings &settings)
+{
   double utmX = 0;
   double utmY = 0;
-  std::string utm_zone_tmp;
-  nav_update_time_ = ros::Time::now();
-  NavsatConversions::LLtoUTM(msg->pose.pose.position.y, 
-			     msg->pose.pose.position.x, 
-			     utmY, utmX, utm_zone_tmp);
+  // Into the datum's zone, like every other output, so a fix across a
+  // zone boundary stays consistent with the utm->odom transform
+  GeonavBatch::LLtoUTM(&msg.pose.pose.position.y, &msg.pose.pose.position.x,
+		       1, datum_.zone, datum_.north, &utmY, &utmX);
   ROS_DEBUG_STREAM_THROTTLE(2.0,"Latest GPS (lat, lon, alt): "
-			    << msg->pose.pose.position.y << " , "
-			    << msg->pose.pose.position.x << " , "
-			    << msg->pose.pose.position.z );
+			    << msg.pose.pose.position.y << " , "
+			    << msg.pose.pose.position.x << " , "
+			    << msg.pose.pose.position.z );
   ROS_DEBUG_STREAM_THROTTLE(2.0,"UTM of latest GPS is (X,Y):" 
 			    << utmX << " , " << utmY);
 
-  // For now the 'nav' frame is that same as the 'base_link' frame
   transform_utm2nav_.setOrigin(tf2::Vector3(utmX, utmY, 
-					  msg->pose.pose.position.z));
-  transform_utm2nav_.setRotation(tf2::Quaternion(msg->pose.pose.orientation.x,
-						 msg->pose.pose.orientation.y,
-						 msg->pose.pose.orientation.z,
-						 msg->pose.pose.orientation.w));
+					  msg.pose.pose.position.z));
+  geometry_msgs::Quaternion orientation = msg.pose.pose.orientation;
+  if (settings.orientation_ned)
+  {
+    // Body FRD relative to NED -> body FLU relative to ENU (REP-103):
+    // q_enu = q_ned2enu * q_ned * q_frd2flu
+    static const double half_sqrt2 = std::sqrt(0.5);
+    static const tf2::Quaternion ned2enu(half_sqrt2, half_sqrt2, 0.0, 0.0);
+    static const tf2::Quaternion frd2flu(1.0, 0.0, 0.0, 0.0);
+    tf2::Quaternion q;
+    tf2::fromMsg(orientation, q);
+    orientation = tf2::toMsg(ned2enu * q * frd2flu);
+  }
+  transform_utm2nav_.setRotation(tf2::Quaternion(orientation.x,
+						 orientation.y,
+						 orientation.z,
+						 orientation.w));
   transform_utm2nav_inverse_=transform_utm2nav_.inverse();
 
-  // Publish Nav/Base Odometry in UTM frame - note frames are set in ::run()
+  // Remove the offset of the nav sensor from base_link
+  updateLeverArm();
+  getRobotOriginUtmPose(transform_utm2nav_, transform_utm2base_,
+			nav_update_time_);
+
+
+  // Nav/Base Odometry in UTM frame - note frames are set in ::run()
   nav_in_utm_.header.stamp = nav_update_time_;
-  nav_in_utm_.header.seq++;
   // Create position information using transform.
   // Convert from transform to pose message
   //tf2::toMsg(transform_utm2nav_, nav_in_utm_.pose.pose);
   tf2::Vector3 tmp;
-  tmp = transform_utm2nav_.getOrigin();
+  tmp = transform_utm2base_.getOrigin();
   nav_in_utm_.pose.pose.position.x = tmp[0];
   nav_in_utm_.pose.pose.position.y = tmp[1];
   nav_in_utm_.pose.pose.position.z = tmp[2];
 
-  nav_in_utm_.pose.pose.position.z = (zero_altitude_ ? 0.0 : nav_in_utm_.pose.pose.position.z);
-  // Create orientation information directy from incoming orientation
-  nav_in_utm_.pose.pose.orientation = msg->pose.pose.orientation;
-  nav_in_utm_.pose.covariance = msg->pose.covariance;
-  // For twist - ignore the rotation since both are in the base_link/nav frame
-  nav_in_utm_.twist.twist.linear = msg->twist.twist.linear;
-  nav_in_utm_.twist.twist.angular = msg->twist.twist.angular;
-  nav_in_utm_.twist.covariance = msg->twist.covariance;
-  // Publish
-  utm_pub_.publish(nav_in_utm_);
+  nav_in_utm_.pose.pose.position.z = (settings.zero_altitude ? 0.0 : nav_in_utm_.pose.pose.position.z);
+  nav_in_utm_.pose.covariance = msg.pose.covariance;
+  if (lever_arm_compensation_)
+  {
+    // Orientation of base_link
+    nav_in_utm_.pose.pose.orientation =
+      tf2::toMsg(transform_utm2base_.getRotation());
+    // Velocities of base_link, in the base_link frame:
+    // v_base = R_base_nav * (v_nav + w x r_nav2base), w_base = R_base_nav * w
+    tf2::Vector3 linear(msg.twist.twist.linear.x,
+			msg.twist.twist.linear.y,
+			msg.twist.twist.linear.z);
+    tf2::Vector3 angular(msg.twist.twist.angular.x,
+			 msg.twist.twist.angular.y,
+			 msg.twist.twist.angular.z);
+    tf2::Matrix3x3 base2nav = transform_nav2base_.getBasis().transpose();
+    linear = base2nav *
+      (linear + angular.cross(transform_nav2base_.getOrigin()));
+    angular = base2nav * angular;
+    nav_in_utm_.twist.twist.linear.x = linear.x();
+    nav_in_utm_.twist.twist.linear.y = linear.y();
+    nav_in_utm_.twist.twist.linear.z = linear.z();
+    nav_in_utm_.twist.twist.angular.x = angular.x();
+    nav_in_utm_.twist.twist.angular.y = angular.y();
+    nav_in_utm_.twist.twist.angular.z = angular.z();
+  }
+  else
+  {
+    // Create orientation information directy from incoming orientation
+    nav_in_utm_.pose.pose.orientation = orientation;
+    // For twist - ignore the rotation since both are in the base_link/nav frame
+    nav_in_utm_.twist.twist.linear = msg.twist.twist.linear;
+    nav_in_utm_.twist.twist.angular = msg.twist.twist.angular;
+  }
+  nav_in_utm_.twist.covariance = msg.twist.covariance;
 
-  // Calculate Nav in odom frame
-  // Note the 'base' and 'nav' frames are the same for now
-  // odom2base = odom2nav = odom2utm * utm2nav
-  transform_odom2base_.mult(transform_utm2odom_inverse_,transform_utm2nav_);
+  // Calculate base in odom frame
+  // odom2nav = odom2utm * utm2nav, odom2base = odom2nav * nav2base
+  transform_odom2nav_.mult(transform_utm2odom_inverse_,transform_utm2nav_);
+  getRobotOriginWorldPose(transform_odom2nav_, transform_odom2base_,
+			  nav_update_time_);
 
   ROS_DEBUG_STREAM_THROTTLE(2.0,"utm2nav X:" 
 			    << transform_utm2nav_.getOrigin()[0] 
@@ -369,23 +1491,26 @@ void GeonavTransform::navOdomCallback(const nav_msgs::OdometryConstPtr& msg)
 			    << "Y:" << transform_odom2base_.getOrigin()[1] );
 
 
-  // Publish Nav odometry in odom frame - note frames are set in ::run()
+  // Nav odometry in odom frame - note frames are set in ::run()
   nav_in_odom_.header.stamp = nav_update_time_;
-  nav_in_odom_.header.seq++;
   // Position from transform
   tf2::toMsg(transform_odom2base_, nav_in_odom_.pose.pose);
-  nav_in_odom_.pose.pose.position.z = (zero_altitude_ ? 0.0 : nav_in_odom_.pose.pose.position.z);
-  // Orientation and twist are uneffected
-  nav_in_odom_.pose.pose.orientation = msg->pose.pose.orientation;
-  nav_in_odom_.pose.covariance = msg->pose.covariance;
-  nav_in_odom_.twist.twist.linear = msg->twist.twist.linear;
-  nav_in_odom_.twist.twist.angular = msg->twist.twist.angular;
-  nav_in_odom_.twist.covariance = msg->twist.covariance;
-  odom_pub_.publish(nav_in_odom_);
-}  // navOdomCallback
+  nav_in_odom_.pose.pose.position.z = (settings.zero_altitude ? 0.0 : nav_in_odom_.pose.pose.position.z);
+  // Orientation and twist are the same as in the utm frame
+  nav_in_odom_.pose.pose.orientation = nav_in_utm_.pose.pose.orientation;
+  nav_in_odom_.pose.covariance = msg.pose.covariance;
+  nav_in_odom_.twist.twist = nav_in_utm_.twist.twist;
+  nav_in_odom_.twist.covariance = msg.twist.covariance;
+  nav_converted_ = true;
+}  // convertNav
 
 void GeonavTransform::geoOdomCallback(const nav_msgs::OdometryConstPtr& msg)
 {
+  if (!geo_limiter_.due(ros::Time::now().toSec(), settings()->geo_rate))
+  {
+    return;
+  }
+
   // Convert position from odometry frame to UTM
   // nav and base are same for now
   // utm2base = utm2nav = utm2odom * odom2nav
@@ -422,5 +1547,116 @@ void GeonavTransform::geoOdomCallback(const nav_msgs::OdometryConstPtr& msg)
   geo_pub_.publish(nav_in_geo_);
 } // geoOdomCallback
 
-} // namespace GeonavTransform
+void GeonavTransform::convertArrays(size_t count)
+{
+  array_x_.resize(count);
+  array_y_.resize(count);
+  // Everything is projected into the datum's zone, so arrays spanning a
+  // zone boundary stay consistent with the utm->odom transform
+  GeonavBatch::LLtoLocal(datum_, array_lat_, array_lon_, array_x_, array_y_);
+}
 
+void GeonavTransform::geoPathCallback(const geographic_msgs::GeoPathConstPtr& msg)
+{
+  const size_t input_count = msg->poses.size();
+  array_lat_.resize(input_count);
+  array_lon_.resize(input_count);
+  for (size_t i = 0; i < input_count; ++i)
+  {
+    array_lat_[i] = msg->poses[i].pose.position.latitude;
+    array_lon_[i] = msg->poses[i].pose.position.longitude;
+  }
+
+  size_t count = input_count;
+  const bool densify = (path_spacing_ > 0.0 || path_tolerance_ > 0.0);
+  if (densify)
+  {
+    // Projected along with the densification; grow the buffers and redo
+    // only when the path doesn't fit.  The three outputs share one
+    // capacity; convertArrays may have shrunk x/y since the last path.
+    const size_t capacity = std::max(array_param_.size(), input_count);
+    array_x_.resize(capacity);
+    array_y_.resize(capacity);
+    array_param_.resize(capacity);
+    count = GeonavGeodesic::densify(datum_, array_lat_.data(), array_lon_.data(),
+				    input_count, path_spacing_, path_tolerance_,
+				    array_x_.data(), array_y_.data(),
+				    array_param_.data(), capacity);
+    if (count > capacity)
+    {
+      array_x_.resize(count);
+      array_y_.resize(count);
+      array_param_.resize(count);
+      GeonavGeodesic::densify(datum_, array_lat_.data(), array_lon_.data(),
+			      input_count, path_spacing_, path_tolerance_,
+			      array_x_.data(), array_y_.data(),
+			      array_param_.data(), count);
+    }
+  }
+  else
+  {
+    convertArrays(count);
+  }
+
+  const bool zero_altitude = settings()->zero_altitude;
+  path_in_odom_.header.stamp = msg->header.stamp;
+  path_in_odom_.header.seq++;
+  path_in_odom_.poses.resize(count);
+  for (size_t i = 0; i < count; ++i)
+  {
+    // Inserted points take the stamp and orientation of their leg's first
+    // pose and interpolate the altitude
+    size_t src = i;
+    double frac = 0.0;
+    if (densify)
+    {
+      src = std::min(static_cast<size_t>(array_param_[i]), input_count - 1);
+      frac = array_param_[i] - src;
+    }
+    const geographic_msgs::GeoPoseStamped &in = msg->poses[src];
+    double altitude = in.pose.position.altitude;
+    if (frac > 0.0)
+    {
+      altitude += frac * (msg->poses[src + 1].pose.position.altitude - altitude);
+    }
+    geometry_msgs::PoseStamped &out = path_in_odom_.poses[i];
+    out.header.stamp = in.header.stamp;
+    out.header.frame_id = odom_frame_id_;
+    out.pose.position.x = array_x_[i];
+    out.pose.position.y = array_y_[i];
+    out.pose.position.z = (zero_altitude ? 0.0 : altitude - datum_.altitude);
+    // Orientation is relative to ENU in both frames
+    out.pose.orientation = in.pose.orientation;
+  }
+  path_pub_.publish(path_in_odom_);
+} // geoPathCallback
+
+void GeonavTransform::geoPoseArrayCallback(const geometry_msgs::PoseArrayConstPtr& msg)
+{
+  const size_t count = msg->poses.size();
+  array_lat_.resize(count);
+  array_lon_.resize(count);
+  for (size_t i = 0; i < count; ++i)
+  {
+    array_lat_[i] = msg->poses[i].position.y;
+    array_lon_[i] = msg->poses[i].position.x;
+  }
+  convertArrays(count);
+
+  const bool zero_altitude = settings()->zero_altitude;
+  pose_array_in_odom_.header.stamp = msg->header.stamp;
+  pose_array_in_odom_.header.seq++;
+  pose_array_in_odom_.poses.resize(count);
+  for (size_t i = 0; i < count; ++i)
+  {
+    geometry_msgs::Pose &out = pose_array_in_odom_.poses[i];
+    out.position.x = array_x_[i];
+    out.position.y = array_y_[i];
+    out.position.z = (zero_altitude ? 0.0 :
+		      msg->poses[i].position.z - datum_.altitude);
+    out.orientation = msg->poses[i].orientation;
+  }
+  pose_array_pub_.publish(pose_array_in_odom_);
+} // geoPoseArrayCallback
+
+} // namespace GeonavTransform
@@ -22,6 +22,8 @@ along with Foobar.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "geonav_transform/geonav_utilities.h"
 
+#include <cmath>
+
 //#include <string>
 //#include <vector>
 
@@ -30,39 +32,158 @@ namespace GeonavTransform
 
 namespace GeonavUtilities
 {
-  void appendPrefix(std::string tfPrefix, std::string &frameId)
+  void appendPrefix(const std::string &tfPrefix, std::string &frameId)
   {
     // Strip all leading slashes for tf2 compliance
     if (!frameId.empty() && frameId.at(0) == '/')
     {
-      frameId = frameId.substr(1);
+      frameId.erase(0, 1);
     }
 
-    if (!tfPrefix.empty() && tfPrefix.at(0) == '/')
+    size_t prefix_start = (!tfPrefix.empty() && tfPrefix.at(0) == '/') ? 1 : 0;
+
+    // If we do have a tf prefix, then put a slash in between
+    if (tfPrefix.size() > prefix_start)
     {
-      tfPrefix = tfPrefix.substr(1);
+      frameId.insert(0, 1, '/');
+      frameId.insert(0, tfPrefix, prefix_start, std::string::npos);
     }
+  }
 
-    // If we do have a tf prefix, then put a slash in between
-    if (!tfPrefix.empty())
+  const FrameIdTable::Id FrameIdTable::EMPTY;
+
+  FrameIdTable::FrameIdTable()
+  {
+    names_.push_back("");
+    ids_[""] = EMPTY;
+  }
+
+  FrameIdTable::Id FrameIdTable::resolve(const std::string &frameId,
+                                         const std::string &tfPrefix)
+  {
+    NameMap &raw = raw_[tfPrefix];
+    NameMap::const_iterator found = raw.find(frameId);
+    if (found != raw.end())
+    {
+      return found->second;
+    }
+
+    // First time we see this name - resolve it once
+    std::string resolved = frameId;
+    appendPrefix(tfPrefix, resolved);
+    NameMap::const_iterator known = ids_.find(resolved);
+    Id id;
+    if (known != ids_.end())
     {
-      frameId = tfPrefix + "/" + frameId;
+      id = known->second;
     }
+    else
+    {
+      id = static_cast<Id>(names_.size());
+      names_.push_back(resolved);
+      ids_[resolved] = id;
+    }
+    raw[frameId] = id;
+    return id;
+  }
+
+  const std::string &FrameIdTable::name(Id id) const
+  {
+    return names_.at(id);
+  }
+
+  size_t FrameIdTable::size() const
+  {
+    return names_.size();
   }
 
   double clampRotation(double rotation)
   {
-    while (rotation > PI)
+    // Same results as the while loops this replaces: [-pi, pi] is kept as
+    // is, larger angles wrap to (-pi, pi] and smaller ones to [-pi, pi).
+    // The selects compile to blends, not branches.
+    const double above = rotation - TAU * std::ceil((rotation - PI) / TAU);
+    const double below = rotation + TAU * std::ceil((-PI - rotation) / TAU);
+    return (rotation > PI) ? above : ((rotation < -PI) ? below : rotation);
+  }
+
+  void wrapAngles(const double *angles, size_t count, double *wrapped)
+  {
+    for (size_t i = 0; i < count; ++i)
+    {
+      wrapped[i] = clampRotation(angles[i]);
+    }
+  }
+
+  void unwrapAngles(const double *angles, size_t count, double *unwrapped)
+  {
+    if (count == 0)
+    {
+      return;
+    }
+    // Wrapped differences, back to front so this works in place
+    for (size_t i = count - 1; i > 0; --i)
+    {
+      unwrapped[i] = clampRotation(angles[i] - angles[i-1]);
+    }
+    // Running sum
+    unwrapped[0] = angles[0];
+    for (size_t i = 1; i < count; ++i)
+    {
+      unwrapped[i] += unwrapped[i-1];
+    }
+  }
+
+  void quaternionToYaw(const double *qx, const double *qy,
+                       const double *qz, const double *qw,
+                       size_t count, double *yaw)
+  {
+    for (size_t i = 0; i < count; ++i)
+    {
+      yaw[i] = std::atan2(2.0 * (qw[i]*qz[i] + qx[i]*qy[i]),
+                          1.0 - 2.0 * (qy[i]*qy[i] + qz[i]*qz[i]));
+    }
+  }
+
+  void yawToQuaternion(const double *yaw, size_t count,
+                       double *qx, double *qy, double *qz, double *qw)
+  {
+    for (size_t i = 0; i < count; ++i)
     {
-      rotation -= TAU;
+      const double half = 0.5 * yaw[i];
+      qx[i] = 0.0;
+      qy[i] = 0.0;
+      qz[i] = std::sin(half);
+      qw[i] = std::cos(half);
     }
+  }
 
-    while (rotation < -PI)
+  RateLimiter::RateLimiter() :
+    next_(0.0)
+  {
+  }
+
+  bool RateLimiter::due(double now, double rate)
+  {
+    if (rate <= 0.0)
+    {
+      return true;
+    }
+    double period = 1.0 / rate;
+    // Time went back (e.g., a looping bag with use_sim_time or a reset
+    // simulation) - restart the slots rather than wait for the old time
+    if (now + period < next_)
+    {
+      next_ = now;
+    }
+    if (now < next_)
     {
-      rotation += TAU;
+      return false;
     }
 
-    return rotation;
+    // Stay on the slot grid unless we fell more than a period behind
+    next_ = (now - next_ < period) ? next_ + period : now + period;
+    return true;
   }
 
 }  // namespace GeonavUtilities
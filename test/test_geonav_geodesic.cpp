@@ -0,0 +1,82 @@
+/*
+
+Copyright (c) 2017, Brian Bingham
+All rights reserved
+
+This file is part of the geonav_transform package.
+
+Geonav_transform is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Geonav_transform is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this package.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "geonav_transform/geonav_geodesic.h"
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <vector>
+
+using namespace GeonavTransform;
+
+// Reference values from GeographicLib (Geodesic.WGS84), JFK to Singapore
+
+TEST(GeonavGeodesic, Inverse)
+{
+  double s12, azi1, azi2;
+  GeonavGeodesic::inverse(40.64, -73.78, 1.36, 103.99, s12, azi1, azi2);
+  EXPECT_NEAR(s12, 15347512.94051294, 1e-3);
+  EXPECT_NEAR(azi1, 3.3057734780176125, 1e-9);
+  EXPECT_NEAR(azi2, 177.48784020815515, 1e-9);
+}
+
+TEST(GeonavGeodesic, Direct)
+{
+  double lat2, lon2, azi2;
+  GeonavGeodesic::direct(40.64, -73.78, -10.0, 1e7, lat2, lon2, azi2);
+  EXPECT_NEAR(lat2, 48.64974514150236, 1e-9);
+  EXPECT_NEAR(lon2, 121.46888471315563, 1e-9);
+  EXPECT_NEAR(azi2, -168.50079458371482, 1e-9);
+}
+
+TEST(GeonavGeodesic, LineMatchesDirect)
+{
+  GeonavGeodesic::GeodesicLine line(40.64, -73.78, -10.0);
+  double lat2, lon2, azi2;
+  line.position(1e7, lat2, lon2, azi2);
+  EXPECT_NEAR(lat2, 48.64974514150236, 1e-9);
+  EXPECT_NEAR(lon2, 121.46888471315563, 1e-9);
+}
+
+TEST(GeonavGeodesic, BatchMatchesScalar)
+{
+  const double lat1[] = {40.64, -33.9, 0.0};
+  const double lon1[] = {-73.78, 18.4, 0.0};
+  const double lat2[] = {1.36, 51.5, 0.5};
+  const double lon2[] = {103.99, -0.12, 179.5};
+  double s12[3], azi1[3], azi2[3];
+  GeonavGeodesic::inverse(lat1, lon1, lat2, lon2, 3, s12, azi1, azi2);
+  for (size_t i = 0; i < 3; ++i)
+  {
+    double s, a1, a2;
+    GeonavGeodesic::inverse(lat1[i], lon1[i], lat2[i], lon2[i], s, a1, a2);
+    EXPECT_DOUBLE_EQ(s12[i], s);
+    EXPECT_DOUBLE_EQ(azi1[i], a1);
+  }
+}
+
+int main(int argc, char **argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,89 @@
+/*
+
+Copyright (c) 2017, Brian Bingham
+All rights reserved
+
+This file is part of the geonav_transform package.
+
+Geonav_transform is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Geonav_transform is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this package.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "geonav_transform/geonav_helmert.h"
+
+#include <gtest/gtest.h>
+
+using namespace GeonavTransform;
+
+// Reference values from PROJ (pyproj) with the same +towgs84 parameters
+
+TEST(GeonavHelmert, OSGB36ToWGS84)
+{
+  const GeonavHelmert::DatumShift shift =
+    GeonavHelmert::datumShift(GeonavHelmert::OSGB36);
+  const double lat = 52.5;
+  const double lon = -1.5;
+  double lat_out, lon_out;
+  GeonavHelmert::toWGS84(shift, &lat, &lon, NULL, 1, &lat_out, &lon_out, NULL);
+  // 1e-8 degrees is about 1 mm
+  EXPECT_NEAR(lat_out, 52.5003738103626, 1e-8);
+  EXPECT_NEAR(lon_out, -1.5014879850609075, 1e-8);
+}
+
+TEST(GeonavHelmert, NAD27ToWGS84)
+{
+  const GeonavHelmert::DatumShift shift =
+    GeonavHelmert::datumShift(GeonavHelmert::NAD27);
+  const double lat = 42.0;
+  const double lon = -93.0;
+  double lat_out, lon_out;
+  GeonavHelmert::toWGS84(shift, &lat, &lon, NULL, 1, &lat_out, &lon_out, NULL);
+  EXPECT_NEAR(lat_out, 42.00000811266147, 1e-8);
+  EXPECT_NEAR(lon_out, -93.00019749833704, 1e-8);
+}
+
+TEST(GeonavHelmert, RoundTrip)
+{
+  const GeonavHelmert::DatumShift shift =
+    GeonavHelmert::datumShift(GeonavHelmert::DHDN);
+  double lat[] = {48.1, 52.5, 54.0};
+  double lon[] = {11.6, 13.4, 9.9};
+  double alt[] = {500.0, 40.0, 0.0};
+  const double lat0[] = {48.1, 52.5, 54.0};
+  const double lon0[] = {11.6, 13.4, 9.9};
+  const double alt0[] = {500.0, 40.0, 0.0};
+  // In place, as allowed
+  GeonavHelmert::toWGS84(shift, lat, lon, alt, 3, lat, lon, alt);
+  GeonavHelmert::fromWGS84(shift, lat, lon, alt, 3, lat, lon, alt);
+  for (size_t i = 0; i < 3; ++i)
+  {
+    EXPECT_NEAR(lat[i], lat0[i], 1e-9);
+    EXPECT_NEAR(lon[i], lon0[i], 1e-9);
+    EXPECT_NEAR(alt[i], alt0[i], 1e-4);
+  }
+}
+
+TEST(GeonavHelmert, FindDatum)
+{
+  GeonavHelmert::DatumId id;
+  ASSERT_TRUE(GeonavHelmert::findDatum("osgb36", id));
+  EXPECT_EQ(id, GeonavHelmert::OSGB36);
+  EXPECT_FALSE(GeonavHelmert::findDatum("NAD28", id));
+}
+
+int main(int argc, char **argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
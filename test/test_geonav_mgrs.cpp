@@ -0,0 +1,90 @@
+/*
+
+Copyright (c) 2017, Brian Bingham
+All rights reserved
+
+This file is part of the geonav_transform package.
+
+Geonav_transform is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Geonav_transform is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this package.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "geonav_transform/geonav_mgrs.h"
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <string>
+
+using namespace GeonavTransform;
+
+// Reference strings as published for the MGRS and with pyproj UTM
+
+TEST(GeonavMgrs, Encode)
+{
+  const double lat[] = {33.3, 42.0};
+  const double lon[] = {44.4, -93.0};
+  char out[2 * GeonavMgrs::MAX_SIZE];
+  ASSERT_EQ(GeonavMgrs::encode(lat, lon, 2, 5, out), 2u);
+  EXPECT_EQ(std::string(out), "38SMB4414084706");
+  EXPECT_EQ(std::string(out + GeonavMgrs::MAX_SIZE), "15TWG0000049776");
+}
+
+TEST(GeonavMgrs, EncodePrecision)
+{
+  const double lat = 33.3;
+  const double lon = 44.4;
+  char out[GeonavMgrs::MAX_SIZE];
+  ASSERT_EQ(GeonavMgrs::encode(&lat, &lon, 1, 2, out), 1u);
+  EXPECT_EQ(std::string(out), "38SMB4484");
+}
+
+TEST(GeonavMgrs, Decode)
+{
+  const char in[] = "38SMB4414084706";
+  double lat, lon;
+  ASSERT_EQ(GeonavMgrs::decode(in, 1, sizeof(in), false, &lat, &lon), 1u);
+  // South west corner of the 1 m square, within a metre of the point
+  EXPECT_NEAR(lat, 33.3, 1e-5);
+  EXPECT_NEAR(lon, 44.4, 1e-5);
+}
+
+TEST(GeonavMgrs, DecodeUTM)
+{
+  const char in[] = "4QFJ12345678";
+  int zone;
+  unsigned char north;
+  double northing, easting;
+  ASSERT_EQ(GeonavMgrs::decodeUTM(in, 1, sizeof(in), false,
+                                  &zone, &north, &northing, &easting), 1u);
+  EXPECT_EQ(zone, 4);
+  EXPECT_EQ(north, 1);
+  EXPECT_DOUBLE_EQ(easting, 612340.0);
+  EXPECT_DOUBLE_EQ(northing, 2356780.0);
+}
+
+TEST(GeonavMgrs, Invalid)
+{
+  const char in[] = "38SZZ";
+  double lat, lon;
+  GeonavMgrs::decode(in, 1, sizeof(in), false, &lat, &lon);
+  EXPECT_TRUE(std::isnan(lat));
+  EXPECT_TRUE(std::isnan(lon));
+}
+
+int main(int argc, char **argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}